@@ -0,0 +1,37 @@
+#include "Expression.h"
+#include "Graph.h"
+#include "TextEditor.h"
+#include "Arena.h"
+
+Arena arena;
+
+_Static_assert((EQ_BUFFER_SIZE <= TEXT_EDITOR_MAX_SIZE) && (TEXT_BUFFER_SIZE <= TEXT_EDITOR_MAX_SIZE),
+               "an editor's storage is larger than TEXT_EDITOR_MAX_SIZE");
+#ifndef HOST_BUILD
+   _Static_assert(sizeof(Arena) <= ARENA_BUDGET, "the arena outgrew ARENA_BUDGET");
+#endif
+
+// empty texts with their editors, no compiled equations and the standard window: -10..10 on both
+// axes with a tick every unit (a window of all 0 would be rejected by drawGraph)
+void initArena(void)
+{
+   int slot;
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      editorInit(&arena.equations[slot].editor, arena.equations[slot].text, EQ_BUFFER_SIZE);
+      clearExpression(&arena.compiledEquations[slot]);
+   }
+   editorInit(&arena.commandEditor, arena.commandText, TEXT_BUFFER_SIZE);
+   editorInit(&arena.functionEditor, arena.functionText, FUNCTION_TEXT_SEL_BUFFER_SIZE);
+   arena.windowBounds[WINDOW_X_MIN] = -10;
+   arena.windowBounds[WINDOW_X_MAX] = 10;
+   arena.windowBounds[WINDOW_Y_MIN] = -10;
+   arena.windowBounds[WINDOW_Y_MAX] = 10;
+   arena.windowBounds[WINDOW_X_SCALE] = 1;
+   arena.windowBounds[WINDOW_Y_SCALE] = 1;
+}
+
+// slot 0..GRAPH_EQUATIONS-1 (equA..equF)
+EquationSlot *arenaEquation(int slot)
+{
+   return &arena.equations[slot];
+}
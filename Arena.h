@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// [Arena]
+//    The text and window buffers main() used to malloc one by one live in a single static
+//    struct instead. The compiler fixes its layout, so there are no heap headers and no
+//    fragmentation, and the size is known when the firmware is linked. `make sram-report` prints
+//    the regions with their offsets and sizes (the table is in SramReport.c) next to the static
+//    data of every other module and fails when the total is over SRAM_BUDGET; a board build of
+//    Arena.c fails if the arena outgrows ARENA_BUDGET.
+//    Each equation is one EquationSlot: its text and the editor over it, indexed by slot
+//    (0 = equA). The compiled bytecode is a separate array, because drawGraph() takes the
+//    six expressions as one array. The buffers are sized to what the bytecode can hold: a
+//    longer equation would not compile into EXPR_CODE_SIZE bytes anyway. The command line's
+//    bytecode only lives while the entry is evaluated, on the stack.
+//    Include Expression.h, Graph.h and TextEditor.h before this header.
+
+#define EQ_BUFFER_SIZE 40                 // size of an equation holder (one text row)
+#define WINDOW_BOUNDS_SIZE 6              // size of array holding window bounds (in entries, not bytes)
+#define TEXT_BUFFER_SIZE 80               // size of temporal buffer holding command line text (two rows)
+#define FUNCTION_TEXT_SEL_BUFFER_SIZE 3   // size of buffer for function selection
+#define ARENA_BUDGET 1024                 // bytes of the board's 2048 the arena may take (813 now, see SramEstimate.txt)
+
+typedef struct {
+   char text[EQ_BUFFER_SIZE];
+   TextEditor editor;
+} EquationSlot;
+
+typedef struct {
+   EquationSlot equations[GRAPH_EQUATIONS];
+   CompiledExpression compiledEquations[GRAPH_EQUATIONS];  // bytecode of the slots, rebuilt whenever an equation is accepted
+   char commandText[TEXT_BUFFER_SIZE];
+   TextEditor commandEditor;
+   char functionText[FUNCTION_TEXT_SEL_BUFFER_SIZE];
+   TextEditor functionEditor;
+   double windowBounds[WINDOW_BOUNDS_SIZE];
+} Arena;
+
+extern Arena arena;
+
+void initArena(void);
+EquationSlot *arenaEquation(int slot);
+
+#endif
@@ -0,0 +1,136 @@
+#include <math.h>
+#include "DisplayHAL.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+#include "Axes.h"
+
+// added before truncating a position, so an axis or tick that falls on a pixel boundary does
+// not land a rounding error short of it
+#define AXES_POSITION_SLACK (1.0 / 1024)
+#define AXES_NONE -32000          // position of an axis too far off the window to be shown by any view
+#define AXES_FAR 16000            // positions are kept within +-AXES_FAR pixels, views within half of it
+
+int axesRow = AXES_NONE;          // window row of y = 0
+int axesColumn = AXES_NONE;       // window column of x = 0
+fixed_t axesFirstTickColumn;      // window column of a tick (Q16.16, plus half a column to round)
+fixed_t axesTickColumns;          // columns between ticks (Q16.16), 0 for no ticks
+fixed_t axesFirstTickRow;         // window row of a tick (truncated like a trace's rows)
+fixed_t axesTickRows;             // rows between ticks, 0 for no ticks
+int axesViewColumn;               // window column and row of the screen's top left pixel (axesSetView)
+int axesViewRow;
+
+// ticks from position first (in pixels) every spacing pixels
+static void setTicks(double first, double spacing, fixed_t *firstTick, fixed_t *tickSpacing)
+{
+   if (spacing < AXES_MIN_TICK_SPACING) {
+      *firstTick = 0;
+      *tickSpacing = 0;
+      return;
+   }
+   *firstTick = doubleToFixed(first + AXES_POSITION_SLACK);
+   *tickSpacing = doubleToFixed(spacing);
+}
+
+// whole pixel holding position (in pixels from the top or left edge of the window)
+static int axisPosition(double position)
+{
+   position = floor(position + AXES_POSITION_SLACK);
+   if ((position < -AXES_FAR) || (position > AXES_FAR)) {
+      return AXES_NONE;
+   }
+   return (int) position;
+}
+
+// the window fills rows 0..rows-1 (FRAME_HEIGHT, or less under a split screen); what lies below
+// is drawn too but not shown. The view starts at the window's top left pixel.
+void axesSetWindow(double xMin, double xMax, double yMin, double yMax, double xScale, double yScale, int rows)
+{
+   double columnsPerX = (FRAME_WIDTH / (xMax - xMin));
+   double rowsPerY = (rows / (yMax - yMin));
+   HAL_CYCLES((10 * CYCLES_FLOAT_ADD) + (8 * CYCLES_FLOAT_MUL) + (4 * CYCLES_FLOAT_DIV) + (4 * CYCLES_FLOAT_TO_INT));
+   // column c samples x = xMin + c * xStep, so x positions round; rows truncate like rowEntry()
+   axesColumn = axisPosition((-xMin * columnsPerX) + 0.5);
+   axesRow = axisPosition(yMax * rowsPerY);
+   if (xScale > 0) {
+      setTicks((((ceil(xMin / xScale) * xScale) - xMin) * columnsPerX) + 0.5, (xScale * columnsPerX),
+               &axesFirstTickColumn, &axesTickColumns);
+   } else {
+      setTicks(0, 0, &axesFirstTickColumn, &axesTickColumns);
+   }
+   if (yScale > 0) {
+      setTicks((yMax - (floor(yMax / yScale) * yScale)) * rowsPerY, (yScale * rowsPerY),
+               &axesFirstTickRow, &axesTickRows);
+   } else {
+      setTicks(0, 0, &axesFirstTickRow, &axesTickRows);
+   }
+   axesSetView(0, 0);
+}
+
+// the screen's top left pixel is column column, row row of the window
+void axesSetView(int column, int row)
+{
+   axesViewColumn = column;
+   axesViewRow = row;
+}
+
+// first tick (Q16.16) at or after whole pixel position first; firstTick is any one of them
+static fixed_t firstTickFrom(fixed_t firstTick, fixed_t spacing, int first)
+{
+   fixed_t position = ((fixed_t) first << FIXED_SHIFT);
+   if ((firstTick >= position) && ((firstTick - spacing) < position)) {
+      return firstTick;
+   }
+   HAL_CYCLES(600);   // __divmodsi4
+   if (firstTick > position) {
+      return (firstTick - (((firstTick - position) / spacing) * spacing));
+   }
+   return (firstTick + ((((position - firstTick) + spacing - 1) / spacing) * spacing));
+}
+
+// draws the pixels of the axes, ticks and grid that fall in screen columns firstX..lastX and rows
+// firstRow..lastRow (the part of the current band or strip that is wanted)
+void axesDrawRegion(int firstX, int lastX, int firstRow, int lastRow)
+{
+   fixed_t tickX;
+   fixed_t tickY;
+   int row0 = (axesRow - axesViewRow);          // screen row of y = 0
+   int column0 = (axesColumn - axesViewColumn);   // screen column of x = 0
+   char rowShown = ((axesRow != AXES_NONE) ? '1' : '0');
+   char columnShown = ((axesColumn != AXES_NONE) ? '1' : '0');
+   HAL_CYCLES(8);
+   if ((rowShown == '1') && (row0 >= firstRow) && (row0 <= lastRow)) {
+      frameDrawSegment(firstX, row0, lastX, row0, '1');
+   }
+   if ((columnShown == '1') && (column0 >= firstX) && (column0 <= lastX)) {
+      frameDrawSegment(column0, firstRow, column0, lastRow, '1');
+   }
+   if (axesTickColumns != 0) {
+      for (tickX = firstTickFrom(axesFirstTickColumn, axesTickColumns, firstX + axesViewColumn);
+           (tickX >> FIXED_SHIFT) <= (lastX + axesViewColumn); tickX += axesTickColumns) {
+         int column = ((int) (tickX >> FIXED_SHIFT) - axesViewColumn);
+         HAL_CYCLES(CYCLES_LONG_OP * 2);
+         if (rowShown == '1') {
+            frameDrawSegment(column, row0 - AXES_TICK_PIXELS, column, row0 + AXES_TICK_PIXELS, '1');
+         }
+         if (axesTickRows == 0) {
+            continue;
+         }
+         for (tickY = firstTickFrom(axesFirstTickRow, axesTickRows, firstRow + axesViewRow);
+              (tickY >> FIXED_SHIFT) <= (lastRow + axesViewRow); tickY += axesTickRows) {
+            int row = ((int) (tickY >> FIXED_SHIFT) - axesViewRow);
+            HAL_CYCLES(CYCLES_LONG_OP * 2);
+            frameDrawSegment(column, row, column, row, '1');
+         }
+      }
+   }
+   // the y axis' ticks stick out sideways, into the region when the axis itself is just outside
+   if ((axesTickRows != 0) && (columnShown == '1')
+       && ((column0 + AXES_TICK_PIXELS) >= firstX) && ((column0 - AXES_TICK_PIXELS) <= lastX)) {
+      for (tickY = firstTickFrom(axesFirstTickRow, axesTickRows, firstRow + axesViewRow);
+           (tickY >> FIXED_SHIFT) <= (lastRow + axesViewRow); tickY += axesTickRows) {
+         int row = ((int) (tickY >> FIXED_SHIFT) - axesViewRow);
+         HAL_CYCLES(CYCLES_LONG_OP * 2);
+         frameDrawSegment(column0 - AXES_TICK_PIXELS, row, column0 + AXES_TICK_PIXELS, row, '1');
+      }
+   }
+}
@@ -0,0 +1,21 @@
+#ifndef AXES_H
+#define AXES_H
+
+// [Axes]
+//    Axes, tick marks every xScale/yScale and a dot grid at the tick crossings, drawn into the
+//    current band or strip like a trace. axesSetWindow() works out once per window where they
+//    fall (ticks as Q16.16 columns and rows, so the spacing does not drift); drawing a region is
+//    then integer only. axesSetView() moves the screen over the window by whole pixels, the way
+//    panGraph() moves it over its samples (see [Frame] in Graph.c), so the axes of a panned view
+//    are drawn from the same positions. The graph screen keeps them in a layer of their own (see
+//    [Layers] in Graph.c) and draws them only when the window changes.
+//    Include DisplayHAL.h and Framebuffer.h before this header.
+
+#define AXES_TICK_PIXELS 2         // a tick mark reaches this far either side of its axis
+#define AXES_MIN_TICK_SPACING 4    // ticks closer than this (in pixels) are left out, with their grid
+
+void axesSetWindow(double xMin, double xMax, double yMin, double yMax, double xScale, double yScale, int rows);
+void axesSetView(int column, int row);
+void axesDrawRegion(int firstX, int lastX, int firstRow, int lastRow);
+
+#endif
@@ -0,0 +1,157 @@
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Latency.h"
+#include "Diagnostics.h"
+#ifdef HOST_BUILD
+   #include <stdio.h>
+#endif
+
+#if DIAGNOSTICS_LINES > 0
+
+// names and titles are in flash (PROGMEM, PSTR), copied out one field at a time
+#ifdef LATENCY_TIMING
+static const char latencyNames[LATENCY_TYPE_COUNT][7] PROGMEM = { "print", "alt", "mode", "enter", "cursor", "delete" };
+static const char latencyBounds[LATENCY_BUCKETS][5] PROGMEM = { "<1", "<2", "<4", "<8", "<16", "<32", "<64", "<128", "<256", "+" };
+#endif
+#ifdef BUS_PROFILING
+static const char busOperationNames[BUS_OPERATIONS][7] PROGMEM = {
+   "other", "init", "clear", "cmdln", "edit", "equ", "menus", "graph", "switch", "cursor"
+};
+#endif
+
+// value right-aligned so it ends before column end (cut at the line's columns)
+static void putText(char *text, int columns, int end, const char *value)
+{
+   int length = 0;
+   int i;
+   while (value[length] != '\0') {
+      length++;
+   }
+   for (i = 0; i < length; i++) {
+      int column = (end - length + i);
+      if ((column >= 0) && (column < columns)) {
+         text[column] = value[i];
+      }
+   }
+}
+
+// putText() for a value in flash
+static void putFlashText(char *text, int columns, int end, const char *value)
+{
+   char field[DIAGNOSTICS_COLUMNS + 1];
+   int i = 0;
+   while ((i < DIAGNOSTICS_COLUMNS) && ((field[i] = (char) pgm_read_byte(&value[i])) != '\0')) {
+      i++;
+   }
+   field[i] = '\0';
+   putText(text, columns, end, field);
+}
+
+static void putNumber(char *text, int columns, int end, unsigned long value)
+{
+   char digits[11];
+   int i = 10;
+   digits[i] = '\0';
+   do {
+      digits[--i] = (char) ('0' + (value % 10));
+      value /= 10;
+   } while (value != 0);
+   putText(text, columns, end, &digits[i]);
+}
+
+#ifdef LATENCY_TIMING
+// value in microseconds as ms with two decimals
+static void putMs(char *text, int columns, int end, unsigned long us)
+{
+   char hundredths[3] = { (char) ('0' + ((us / 100) % 10)), (char) ('0' + ((us / 10) % 10)), '\0' };
+   putText(text, columns, end, hundredths);
+   putFlashText(text, columns, end - 2, PSTR("."));
+   putNumber(text, columns, end - 3, us / 1000);
+}
+
+// a title, the bucket bounds, then per input type the keys, min and max and the histogram
+static void formatLatencyLine(int line, char *text, int columns)
+{
+   int i;
+   if (line == 0) {
+      putFlashText(text, columns, 25, PSTR("KEY TO PIXEL LATENCY (MS)"));
+   } else if (line == 1) {
+      for (i = 0; i < LATENCY_BUCKETS; i++) {
+         putFlashText(text, columns, (4 * i) + 4, latencyBounds[i]);
+      }
+   } else {
+      int type = ((line - 2) / 2);
+      const LatencyStats *stats = latencyGetStats(LATENCY_TYPES[type]);
+      if ((line % 2) == 0) {
+         putFlashText(text, columns, 6, latencyNames[type]);
+         putNumber(text, columns, 12, stats->count);
+         putFlashText(text, columns, 17, PSTR("min"));
+         putMs(text, columns, 26, stats->minUs);
+         putFlashText(text, columns, 31, PSTR("max"));
+         putMs(text, columns, 40, stats->maxUs);
+      } else {
+         for (i = 0; i < LATENCY_BUCKETS; i++) {
+            putNumber(text, columns, (4 * i) + 4, stats->buckets[i]);
+         }
+      }
+   }
+}
+
+#endif
+
+#ifdef BUS_PROFILING
+// a title, the column names, then one line per operation
+static void formatBusLine(int line, char *text, int columns)
+{
+   if (line == 0) {
+      putFlashText(text, columns, 22, PSTR("BUS BYTES BY OPERATION"));
+   } else if (line == 1) {
+      putFlashText(text, columns, 14, PSTR("cmd"));
+      putFlashText(text, columns, 22, PSTR("param"));
+      putFlashText(text, columns, 32, PSTR("vram"));
+      putFlashText(text, columns, 40, PSTR("csrw"));
+   } else {
+      const BusProfile *profile = busProfileGet((unsigned char) (line - 2));
+      putFlashText(text, columns, 6, busOperationNames[line - 2]);
+      putNumber(text, columns, 14, profile->commandBytes);
+      putNumber(text, columns, 22, profile->parameterBytes);
+      putNumber(text, columns, 32, profile->payloadBytes);
+      putNumber(text, columns, 40, profile->csrwSequences);
+   }
+}
+#endif
+
+// line 0..DIAGNOSTICS_LINES-1 of the screen, padded with spaces to columns
+void diagnosticsFormatLine(int line, char *text, int columns)
+{
+   int i;
+   for (i = 0; i < columns; i++) {
+      text[i] = ' ';
+   }
+#ifdef LATENCY_TIMING
+   if (line < DIAGNOSTICS_LATENCY_LINES) {
+      formatLatencyLine(line, text, columns);
+   }
+#endif
+#ifdef BUS_PROFILING
+   if ((line >= DIAGNOSTICS_BUS_FIRST_LINE) && (line < DIAGNOSTICS_LINES)) {
+      formatBusLine(line - DIAGNOSTICS_BUS_FIRST_LINE, text, columns);
+   }
+#endif
+}
+
+#ifdef HOST_BUILD
+// the diagnostics screen on stdout
+void diagnosticsPrint(void)
+{
+   char text[DIAGNOSTICS_COLUMNS + 1];
+   int line;
+   text[DIAGNOSTICS_COLUMNS] = '\0';
+   for (line = 0; line < DIAGNOSTICS_LINES; line++) {
+      diagnosticsFormatLine(line, text, DIAGNOSTICS_COLUMNS);
+      printf("%s\n", text);
+   }
+}
+#endif
+
+#endif
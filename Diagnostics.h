@@ -0,0 +1,37 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+// [Diagnostics Screen]
+//    Text of the hidden diagnostics screen, reached by pressing the menu key on the menu screen.
+//    The screen has two sections, each only in builds with its flag:
+//    > key-to-pixel latency per input type (Latency.h, LATENCY_TIMING): the count, minimum and
+//      maximum on one line, the histogram on the next
+//    > bus bytes per top-level operation (the [Bus Profile] in DisplayBus.h, BUS_PROFILING)
+//    Without either flag DIAGNOSTICS_LINES is 0 and the firmware has no diagnostics screen.
+//    diagnosticsFormatLine() fills one text row at a time, so the screen is written with
+//    writeDisplayMemory() and needs no buffer of its own. The host build prints the same lines
+//    with diagnosticsPrint().
+//    Include Latency.h and DisplayBus.h before this header.
+
+#ifdef LATENCY_TIMING
+   #define DIAGNOSTICS_LATENCY_LINES (2 + (2 * LATENCY_TYPE_COUNT))
+   #define DIAGNOSTICS_BUS_FIRST_LINE (DIAGNOSTICS_LATENCY_LINES + 1)   // after one blank line
+#else
+   #define DIAGNOSTICS_LATENCY_LINES 0
+   #define DIAGNOSTICS_BUS_FIRST_LINE 0
+#endif
+#ifdef BUS_PROFILING
+   #define DIAGNOSTICS_LINES (DIAGNOSTICS_BUS_FIRST_LINE + 2 + BUS_OPERATIONS)   // 27 of the 30 text rows with both
+#else
+   #define DIAGNOSTICS_LINES DIAGNOSTICS_LATENCY_LINES
+#endif
+#define DIAGNOSTICS_COLUMNS 40   // every field fits in 40
+
+#if DIAGNOSTICS_LINES > 0
+   void diagnosticsFormatLine(int line, char *text, int columns);
+   #ifdef HOST_BUILD
+      void diagnosticsPrint(void);
+   #endif
+#endif
+
+#endif
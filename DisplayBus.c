@@ -0,0 +1,336 @@
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+
+// [Port B Output Pin Definitions Used By The Bus]
+   #define CLOCK_PIN 0b00001000
+   #define A0_PIN 0b00000100        // used to distinguish between commands and data/parameters
+   #define DB7_PIN 0b00000010       // data pin 7
+   #define DB6_PIN 0b00000001       // data pin 6
+
+// (For Port D, display pins DB5-DB0 correspond to Port D Pins 7-2)
+   #define BUS_PINS_B (A0_PIN | DB7_PIN | DB6_PIN)
+   #define BUS_PINS_D 0b11111100
+
+// [Display Commands Used By The Bulk Writes]
+   #define C_CSRW 0b01000110
+   #define C_MEMWRITE 0b01000010
+   #define C_CSRDIR_RIGHT 0b01001100
+   #define C_CSRDIR_DOWN 0b01001111
+
+#define DISPLAY_QUEUE_MASK (DISPLAY_QUEUE_SIZE - 1)
+
+// [ISR Cycle Model]
+//    HAL_CYCLES() charges the host model with the AVR cycles of each path through the ISR,
+//    estimated from the instruction timings (IN/OUT/LDI 1, LDS/STS/LD/SBI 2, taken branch 2).
+//    Entry/exit covers interrupt response, vector jump and RETI (11) plus the avr-gcc
+//    prologue/epilogue (15 + 4 per saved register). On the board HAL_CYCLES() is empty.
+#ifndef DISPLAY_BUS_BIT_LOOP
+   #define DISPLAY_ISR_ENTRY_EXIT_CYCLES 50   // 6 saved registers
+#else
+   #define DISPLAY_ISR_ENTRY_EXIT_CYCLES 66   // 10 saved registers (16-bit loop counter and shift temporaries)
+#endif
+
+// transmit ring: the main program only moves the tail, ISR(TIMER0_COMPA_vect) only moves the head
+volatile unsigned char displayQueueBytes[DISPLAY_QUEUE_SIZE];
+volatile char displayQueueIsCommand[DISPLAY_QUEUE_SIZE];  // '1' if the byte goes out with A0 high
+volatile unsigned char displayQueueHead;                  // next entry the ISR will send
+volatile unsigned char displayQueueTail;                  // next free entry
+volatile char byteInFlight;                               // '1' between the rising and falling edge of a transfer
+volatile char directMode;                                 // '1' while the main program drives the bus itself
+
+#ifdef BUS_PROFILING
+// bus profile (see [Bus Profile] in DisplayBus.h), only touched by the main program
+BusProfile busProfiles[BUS_OPERATIONS];
+unsigned char busOperation = BUS_OP_OTHER;   // operation the bytes are charged to
+unsigned char busOperationDepth;             // busProfileBegin() calls not yet ended
+char busPayload = '0';                       // '1' while data bytes follow a C_MEMWRITE
+#endif
+
+// timer 0 is used to generate the display's clock signal
+void initTimer0(void)
+{
+   displayQueueHead = 0;
+   displayQueueTail = 0;
+   byteInFlight = '0';
+   directMode = '0';
+   TCCR0A |=  (1 << WGM01);   // put timer in CTC mode
+   TCCR0B |= (1 << CS01);     // timer counts every 8 clock cycles
+   TIMSK0 |= (1 << OCIE0A);   // set to interrupt on compare
+   OCR0A = DISPLAY_CLOCK_COMPARE;
+   TCNT0 = 0;
+}
+
+#ifndef DISPLAY_BUS_BIT_LOOP
+
+// DB7/DB6 sit on PB1/PB0 and DB5-DB0 on PD7-PD2, so each port image is a single shift and mask
+static inline void putByteOnBus(unsigned char byteToSend, char currentIsCommand)
+{
+   unsigned char portBImage = ((PORTB & ~BUS_PINS_B) | (byteToSend >> 6));
+   if (currentIsCommand == '1') {
+      portBImage |= A0_PIN;
+   }
+   PORTB = portBImage;
+   PORTD = ((PORTD & ~BUS_PINS_D) | (byteToSend << 2));
+   HAL_CYCLES(21);   // swap/lsr/andi for DB7-DB6, lsl x2 for DB5-DB0, two in/out pairs
+}
+
+#else
+
+// original bit-by-bit mapping, kept so the host benchmark can compare against it
+static inline void putByteOnBus(unsigned char byteToSend, char currentIsCommand)
+{
+   HAL_CYCLES(2);
+   if (currentIsCommand == '1') {
+      PORTB |= A0_PIN;
+      HAL_CYCLES(4);
+   } else if ((PORTB & A0_PIN) == A0_PIN) {
+      PORTB ^= A0_PIN;
+      HAL_CYCLES(6);
+   }
+   int i;
+   HAL_CYCLES(2);
+   for (i = 7; i >= 0; i--) {
+      HAL_CYCLES(8 + 4 + (4 * i) + 6);   // 16-bit loop control and range test, (1 << i), mask test
+      if (i >= 6) {
+         unsigned char mask;
+         HAL_CYCLES(3);
+         if (i == 7) {
+            mask = DB7_PIN;
+         } else {
+            mask = DB6_PIN;
+         }
+         if ((byteToSend & (1 << i)) == (1 << i)) {
+            PORTB |= mask;
+            HAL_CYCLES(3);
+         } else if ((PORTB & mask) == mask) {
+            PORTB ^= mask;
+            HAL_CYCLES(7);
+         } else {
+            HAL_CYCLES(4);
+         }
+      } else if ((byteToSend & (1 << i)) == (1 << i)) {
+         PORTD |= (1 << (i+2));
+         HAL_CYCLES(4 + (4 * (i + 2)) + 3);
+      } else if ((PORTD & (1 << (i+2))) == (1 << (i+2))) {
+         PORTD ^= (1 << (i+2));
+         HAL_CYCLES(2 * (4 + (4 * (i + 2))) + 8);
+      } else {
+         HAL_CYCLES(4 + (4 * (i + 2)) + 5);
+      }
+   }
+}
+
+#endif
+
+// one byte per compare match, pipelined: the match lowers the clock so the controller latches the
+// byte raised by the previous match, then puts the next queued byte on the bus and raises the clock
+// again. With nothing queued the ISR parks the clock low and masks its own interrupt until
+// sendByteToDisplay() queues more work.
+// The ISR rewrites the whole of PORTB's bus image, so a read-modify-write of PORTB in the main
+// program (anything but a single-bit sbi/cbi) must hold interrupts off around it.
+ISR(TIMER0_COMPA_vect)
+{
+   HAL_CYCLES(DISPLAY_ISR_ENTRY_EXIT_CYCLES + 3);   // + clock level test
+   if ((PORTB & CLOCK_PIN) == CLOCK_PIN) {
+      PORTB &= ~CLOCK_PIN;
+      byteInFlight = '0';   // the falling edge has latched the byte
+      HAL_CYCLES(5);
+   }
+   unsigned char head = displayQueueHead;
+   HAL_CYCLES(5);
+   if (byteInFlight == '0') {
+      if (head != displayQueueTail) {
+         putByteOnBus(displayQueueBytes[head], displayQueueIsCommand[head]);
+         PORTB |= CLOCK_PIN;
+         HAL_BUS_STROBE();
+         displayQueueHead = ((head + 1) & DISPLAY_QUEUE_MASK);
+         byteInFlight = '1';
+         HAL_CYCLES(17);   // indexed loads of the byte and its tag, clock, head and flag stores
+      } else {
+         TIMSK0 &= ~(1 << OCIE0A);
+         HAL_CYCLES(4);
+      }
+   }
+}
+
+#ifdef BUS_PROFILING
+static inline void profileByte(unsigned char currentByte, char currentIsCommand)
+{
+   BusProfile *profile = &busProfiles[busOperation];
+   HAL_CYCLES(14);   // indexed profile pointer, compares, one 32-bit increment
+   if (currentIsCommand == '1') {
+      profile->commandBytes++;
+      busPayload = ((currentByte == C_MEMWRITE) ? '1' : '0');
+      if (currentByte == C_CSRW) {
+         profile->csrwSequences++;
+      }
+   } else if (busPayload == '1') {
+      profile->payloadBytes++;
+   } else {
+      profile->parameterBytes++;
+   }
+}
+#else
+   #define profileByte(currentByte, currentIsCommand)
+#endif
+
+// queues one byte; only waits if the ISR has not yet made room in the ring
+// (in direct mode the byte is clocked out on the spot instead, see beginDirectMode)
+int sendByteToDisplay(unsigned char currentByte, char currentIsCommand)
+{
+   profileByte(currentByte, currentIsCommand);
+   if (directMode == '1') {
+      cli();   // putByteOnBus() rewrites PORTB and PORTD with in/out pairs
+      putByteOnBus(currentByte, currentIsCommand);
+      sei();
+      PORTB |= CLOCK_PIN;
+      HAL_BUS_STROBE();
+      PORTB &= ~CLOCK_PIN;   // sbi/cbi keep the clock high for 2 cycles (125 ns), the controller latches on the fall
+      HAL_CYCLES(17);        // call/return, direct mode test, cli/sei, strobe
+      return 0;
+   }
+   HAL_CYCLES(22);   // call/return, ring full test, indexed stores, tail store, OCIE0A set
+   unsigned char tail = displayQueueTail;
+   unsigned char nextTail = ((tail + 1) & DISPLAY_QUEUE_MASK);
+   while (nextTail == displayQueueHead) {
+      _delay_us(1);
+   }
+   displayQueueBytes[tail] = currentByte;
+   displayQueueIsCommand[tail] = currentIsCommand;
+   displayQueueTail = nextTail;   // publish the entry only once it is complete
+   TIMSK0 |= (1 << OCIE0A);       // wake the ISR if it parked on an empty queue
+   return 0;
+}
+
+// queues a command byte followed by its parameters
+int sendCommandToDisplay(unsigned char command, const unsigned char *params, unsigned char numParams)
+{
+   unsigned char i;
+   sendByteToDisplay(command, '1');
+   for (i = 0; i < numParams; i++) {
+      sendByteToDisplay(params[i], '0');
+   }
+   return 0;
+}
+
+// [Direct Mode]
+//    For bulk transfers the two interrupts per byte cost more than the transfer itself. Between
+//    beginDirectMode() and endDirectMode() Timer0 is masked and sendByteToDisplay() strobes CLOCK_PIN,
+//    A0_PIN and the data pins from the calling context as fast as the loop can run. Anything queued
+//    before is drained first, so ordering with the ISR path is preserved. Only for the main program
+//    with interrupts enabled: each byte's port writes run between cli() and sei().
+int beginDirectMode()
+{
+   flushDisplayQueue();
+   TIMSK0 &= ~(1 << OCIE0A);
+   directMode = '1';
+   return 0;
+}
+
+// hands the bus back to the ISR; the next queued byte unmasks Timer0 again
+int endDirectMode()
+{
+   directMode = '0';
+   return 0;
+}
+
+// barrier: returns once every queued byte has been latched by the controller
+int flushDisplayQueue()
+{
+   while ((displayQueueHead != displayQueueTail) || (byteInFlight == '1')) {
+      _delay_us(1);
+   }
+   return 0;
+}
+
+char displayQueueEmpty()
+{
+   if ((displayQueueHead == displayQueueTail) && (byteInFlight == '0')) {
+      return '1';
+   }
+   return '0';
+}
+
+int setCursorAddress(unsigned int address)
+{
+   sendByteToDisplay(C_CSRW, '1');
+   sendByteToDisplay((unsigned char) (address & 0x00FF), '0');   // low byte first
+   sendByteToDisplay((unsigned char) (address >> 8), '0');
+   return 0;
+}
+
+// bulk writes rely on the cursor advancing by one address after every byte written
+int setCursorDirection()
+{
+   sendByteToDisplay(C_CSRDIR_RIGHT, '1');
+   return 0;
+}
+
+// column writes: the cursor advances by one row (AP) after every byte; setCursorDirection()
+// restores the default
+int setCursorDirectionDown()
+{
+   sendByteToDisplay(C_CSRDIR_DOWN, '1');
+   return 0;
+}
+
+// sets the cursor once and streams length bytes under a single C_MEMWRITE (cursor auto-increments)
+int writeDisplayMemory(unsigned int address, const unsigned char *data, unsigned int length)
+{
+   unsigned int i;
+   setCursorAddress(address);
+   sendByteToDisplay(C_MEMWRITE, '1');
+   for (i = 0; i < length; i++) {
+      sendByteToDisplay(data[i], '0');
+      HAL_CYCLES(7);   // ld X+, 16-bit compare and branch
+   }
+   return 0;
+}
+
+// same as writeDisplayMemory, but every byte of the run is value
+int fillDisplayMemory(unsigned int address, unsigned char value, unsigned int length)
+{
+   unsigned int i;
+   setCursorAddress(address);
+   sendByteToDisplay(C_MEMWRITE, '1');
+   for (i = 0; i < length; i++) {
+      sendByteToDisplay(value, '0');
+      HAL_CYCLES(5);   // 16-bit compare and branch
+   }
+   return 0;
+}
+
+#ifdef BUS_PROFILING
+// [Bus Profile]
+void busProfileBegin(unsigned char operation)
+{
+   if (busOperationDepth++ == 0) {
+      busOperation = operation;
+      busProfiles[operation].calls++;
+   }
+}
+
+void busProfileEnd()
+{
+   if ((busOperationDepth > 0) && (--busOperationDepth == 0)) {
+      busOperation = BUS_OP_OTHER;
+   }
+}
+
+void busProfileReset()
+{
+   unsigned char operation;
+   for (operation = 0; operation < BUS_OPERATIONS; operation++) {
+      busProfiles[operation].calls = 0;
+      busProfiles[operation].commandBytes = 0;
+      busProfiles[operation].parameterBytes = 0;
+      busProfiles[operation].payloadBytes = 0;
+      busProfiles[operation].csrwSequences = 0;
+   }
+}
+
+const BusProfile *busProfileGet(unsigned char operation)
+{
+   return &busProfiles[operation];
+}
+#endif
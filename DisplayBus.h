@@ -0,0 +1,89 @@
+#ifndef DISPLAY_BUS_H
+#define DISPLAY_BUS_H
+
+// [Display Bus]
+//    Shared by GraphingCalc.c and DisplayDemoGraphicsOnly.c. Bytes for the display controller are
+//    queued together with their command/data tag and clocked out by ISR(TIMER0_COMPA_vect), so the
+//    caller only waits when the queue is full. Call flushDisplayQueue() wherever the controller
+//    must have received everything sent so far (before timed delays, before reading state back).
+
+#define DISPLAY_QUEUE_SIZE 32   // entries in the transmit ring (power of two, fits an 8-bit index)
+
+// Timer0 compare value: one byte every (DISPLAY_CLOCK_COMPARE + 1) * 8 CPU cycles. 12 gives 104
+// cycles (~154 KB/s), just above the longest ISR path (101 cycles, see `make bench-isr`).
+#ifndef DISPLAY_CLOCK_COMPARE
+   #define DISPLAY_CLOCK_COMPARE 12
+#endif
+
+void initTimer0(void);
+int sendByteToDisplay(unsigned char currentByte, char currentIsCommand);
+int sendCommandToDisplay(unsigned char command, const unsigned char *params, unsigned char numParams);
+int flushDisplayQueue();
+char displayQueueEmpty();
+int beginDirectMode();
+int endDirectMode();
+
+// bulk VRAM access (cursor auto-increment to the right, see setCursorDirection)
+int setCursorAddress(unsigned int address);
+int setCursorDirection();
+int setCursorDirectionDown();
+int writeDisplayMemory(unsigned int address, const unsigned char *data, unsigned int length);
+int fillDisplayMemory(unsigned int address, unsigned char value, unsigned int length);
+
+// [Bus Profile]
+//    sendByteToDisplay() charges every byte to the top-level operation in progress.
+//    busProfileBegin()/busProfileEnd() bracket an operation. Operations nested inside another
+//    one count as part of the outer one, so panGraph()'s drawGraph() is charged to the pan.
+//    Bytes sent outside any operation go to BUS_OP_OTHER.
+//    For each operation the profile keeps:
+//    > command bytes
+//    > parameter bytes (including the cursor addresses)
+//    > payload bytes (VRAM data after C_MEMWRITE)
+//    > the number of C_CSRW sequences
+//    Comparing those shows which screens spend the bus on addressing. The diagnostics screen
+//    shows the counters, and the host harness prints them with diagnosticsPrint().
+//    Counting costs HAL_CYCLES(14) per byte and the counters' SRAM, so the profile is only built
+//    with -DBUS_PROFILING (the host harness turns it on). Without it the bracketing calls are
+//    empty and BUS_PROFILED() just runs its statement; the operation numbers stay defined.
+   #define BUS_OP_OTHER 0             // outside any operation below
+   #define BUS_OP_INIT 1              // initDisplay
+   #define BUS_OP_CLEAR 2             // clearAllDisplayMemory
+   #define BUS_OP_COMMAND_LINE 3      // drawCommandLine, printCmdOutput, clearBuffer
+   #define BUS_OP_EDIT 4              // characters redrawn after an edit (drawCharacter)
+   #define BUS_OP_EQUATIONS 5         // drawEquationScreen, drawEquationsMenuScreen
+   #define BUS_OP_MENUS 6             // drawMenuScreen, drawSpecialFunctionsScreen, diagnostics
+   #define BUS_OP_GRAPH 7             // drawGraph, panGraph, graphSetSplit
+   #define BUS_OP_SCREEN_SWITCH 8     // showScreen, graphShowText (C_SCROLL)
+   #define BUS_OP_CURSOR 9            // updateScreenCursor, moveTextCursor
+   #define BUS_OPERATIONS 10
+
+typedef struct {
+   unsigned int calls;               // top-level busProfileBegin() calls
+   unsigned long commandBytes;
+   unsigned long parameterBytes;     // data bytes that are not VRAM payload
+   unsigned long payloadBytes;       // data bytes written to VRAM (after C_MEMWRITE)
+   unsigned long csrwSequences;      // C_CSRW commands, 3 bytes each with their address
+} BusProfile;
+
+#ifdef BUS_PROFILING
+   // runs statement with its bus bytes charged to operation
+   #define BUS_PROFILED(operation, statement) do { busProfileBegin(operation); statement; busProfileEnd(); } while (0)
+
+   void busProfileBegin(unsigned char operation);
+   void busProfileEnd();
+   void busProfileReset();
+   const BusProfile *busProfileGet(unsigned char operation);
+#else
+   #define BUS_PROFILED(operation, statement) do { statement; } while (0)
+
+   static inline void busProfileBegin(unsigned char operation)
+   {
+      (void) operation;
+   }
+
+   static inline void busProfileEnd()
+   {
+   }
+#endif
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include "SED1335Sim.h"
+#include "DisplayBus.h"
+
+// [Display Bus ISR Benchmark]
+//    Streams a block of VRAM data through ISR(TIMER0_COMPA_vect) on the host model and reports the
+//    modelled AVR cycles of the ISR body, then streams the same block in direct mode for comparison.
+//    Built once per port-mapping variant and clock setting (see the bench-isr target in the Makefile)
+//    so the rows can be compared side by side.
+
+#define BENCH_STREAM_BYTES 4096
+#define BENCH_IDLE_US 1000
+
+#ifdef DISPLAY_BUS_BIT_LOOP
+   #define BENCH_VARIANT "bit loop"
+#else
+   #define BENCH_VARIANT "shift/mask"
+#endif
+
+// keypad polling is not part of this benchmark
+void TIMER1_COMPA_vect(void)
+{
+}
+
+static void printResult(const char *path, SimCounters counters)
+{
+   unsigned long bytes = counters.commandBytes + counters.dataBytes;
+   double cyclesPerByte = ((double) counters.cpuCycles) / bytes;
+   double isrCyclesPerByte = ((double) counters.timer0Cycles) / bytes;
+   double bytesPerSecond = ((double) bytes) * simGetCpuHz() / counters.cpuCycles;
+   printf("   %-6s  %6.1f cycles/byte  ISR %6.1f cycles/byte  longest ISR %4lu cycles  %8.0f bytes/s\n",
+          path, cyclesPerByte, isrCyclesPerByte, counters.timer0MaxCycles, bytesPerSecond);
+}
+
+int main(void)
+{
+   simReset();
+   initTimer0();
+   simSetInterrupts('1');
+   setCursorDirection();
+   flushDisplayQueue();
+
+   simBeginCall("idle");
+   simDelayUs(BENCH_IDLE_US);
+   SimCounters idle = simEndCall();
+
+   simBeginCall("queue");
+   fillDisplayMemory(0x0000, 0b01010101, BENCH_STREAM_BYTES);
+   flushDisplayQueue();
+   SimCounters queued = simEndCall();
+
+   simBeginCall("direct");
+   beginDirectMode();
+   fillDisplayMemory(0x0000, 0b10101010, BENCH_STREAM_BYTES);
+   endDirectMode();
+   SimCounters direct = simEndCall();
+
+   printf("\n%-10s OCR0A %3d  period %4lu cycles  idle interrupts %4lu\n", BENCH_VARIANT,
+          DISPLAY_CLOCK_COMPARE, (unsigned long) ((DISPLAY_CLOCK_COMPARE + 1) * 8), idle.timer0Interrupts);
+   printResult("queue", queued);
+   printResult("direct", direct);
+   printf("\n");
+   return 0;
+}
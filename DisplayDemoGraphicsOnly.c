@@ -1,7 +1,9 @@
 #include <stdio.h>
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+#include "Expression.h"
 
 // [Display Commands and Parameters]
    // system set commands and parameters
@@ -107,6 +109,9 @@
    // MEMWRITE Command (writes to memory at cursor address)
    #define C_MEMWRITE 0b01000010
    
+   // Display Memory Layout
+   #define DISPLAY_MEMORY_SIZE 32768  // bytes of SRAM attached to the controller (addresses 0x0000-0x7FFF)
+   
    // (Character Codes Defs not needed - just use ASCII codes)
 
 // [Port B Output Pin Definitions]
@@ -126,33 +131,47 @@
    #define WINDOW_BOUNDS_SIZE 6          // size of array holding window bounds (in entries, not bytes)
    #define TEXT_BUFFER_SIZE 200          // size of temporal buffer holding command line text
    #define FUNCTION_TEXT_SEL_BUFFER_SIZE 3 // size of buffer for function selection
+   #define SCREEN_WIDTH 320              // display width in pixels
+   #define SCREEN_HEIGHT 240             // display height in pixels
+   #define X_MIN -10.0                   // left edge of the demo graph window
+   #define X_MAX 10.0                    // right edge of the demo graph window
+   #define YMIN -10.0                    // bottom edge of the demo graph window
+   #define YMAX 10.0                     // top edge of the demo graph window
 
-// global volatile variables for display output
-//    > char byteToSend
-//    > char byteSent
+// global volatile variables
+//    > (display transmit queue lives in DisplayBus.c)
 //    > keypad input buffer
 //    > input buffer write index
 //    > int numDClockIntervals
 
-volatile unsigned char byteToSend;           // byte that is to be sent (or was last sent)
-volatile char byteAwaitingTransmission;      // flag to tell interrupt it needs to send byteToSend
-volatile char isCommand;                     // flag used to determine whether A0 will be low or high
 volatile char buttonInput;
 volatile char prevButtonInput;
-volatile char buttonInputRead;
+volatile char buttonRead;
+unsigned char plotRows[SCREEN_WIDTH];    // trace being drawn: row of the point in each column (FRAME_NO_ROW if none)
+unsigned char shownRows[SCREEN_WIDTH];   // trace currently on screen, erased by the next endPlot()
+PlotWindow demoWindow;                   // X_MIN..X_MAX by YMIN..YMAX in Q16.16
 //volatile unsigned char* volatile inBuffer;   // buffer for keypad input
 //volatile unsigned char prevInput;            // used to ensure accurate keypress detection (always 1 character per button push/release)
 //volatile unsigned int nextBufferIndex;       // used to determine next index available to write to in buffer (unless buffer is full)
 
-// timer 0 is used to generate the display's clock signal
-static inline void initTimer0(void)
-{
-   TCCR0A |=  (1 << WGM01);   // put timer in CTC mode
-   TCCR0B |= (1 << CS01);     // timer counts every 8 clock cycles
-   TIMSK0 |= (1 << OCIE0A);   // set to interrupt on compare
-   OCR0A = 10; // interrupt triggered every 80 clock cycles to generate display clock (~200 kHz)
-   TCNT0 = 0;
-}
+int initDisplay();
+int systemSet();
+int setScroll();
+int setHDOT_SCR();
+int setOverlay();
+int setDispState(char on);
+int clearAllDisplayMemory();
+int clearDisplay();
+int setCSRW();
+int setCSRForm();
+int drawParabola();
+int drawNegLine();
+int drawPosLine();
+int drawExpression(const CompiledExpression *expression);
+int drawPoint(int scaledX, int scaledY);
+int clearTrace(unsigned char *rows);
+int beginPlot();
+int endPlot();
 
 // timer 1 is used for polling the keypad once every ~80 milliseconds (doubles as a debouncer)
 static inline void initTimer1(void)
@@ -164,45 +183,6 @@ static inline void initTimer1(void)
    TCNT1 = 0;
 }
 
-ISR(TIMER0_COMPA_vect)
-{
-   PORTB ^= CLOCK_PIN;
-   if (((PORTB & CLOCK_PIN) == CLOCK_PIN) && (byteAwaitingTransmission == '1')) {
-      if (isCommand == '1') {
-         PORTB |= A0_PIN;
-      } else if ((PORTB & A0_PIN) == A0_PIN) {
-         PORTB ^= A0_PIN;
-      }
-      int i;
-      for (i = 7; i >= 0; i--) {
-         if (i >= 6) {
-            unsigned char mask;
-            if (i == 7) {
-               mask = DB7_PIN;
-            } else {
-               mask = DB6_PIN;
-            }
-            if ((byteToSend & (1 << i)) == (1 << i)) {
-               PORTB |= mask;
-            } else if ((PORTB & mask) == mask) {
-               PORTB ^= mask;
-            }
-         } else if ((byteToSend & (1 << i)) == (1 << i)) {
-            PORTD |= (1 << (i+2));
-         } else if ((PORTD & (1 << (i+2))) == (1 << (i+2))) {
-            PORTD ^= (1 << (i+2));
-         }
-      }
-      byteAwaitingTransmission = '0';
-   } else if ((PORTB & CLOCK_PIN) == CLOCK_PIN) {
-      PORTB = CLOCK_PIN;
-      PORTD = 0b00000000;
-   }/* else {
-      PORTB = 0b00000000;
-      PORTD = 0b00000000;
-   }*/   
-}
-
 ISR(TIMER1_COMPA_vect)
 {
    sei();   // allow ISR for timer0 to interrupt this ISR
@@ -231,12 +211,9 @@ ISR(TIMER1_COMPA_vect)
 
 int main(void)
 {
-   byteToSend = 0b00000000;
-   byteAwaitingTransmission = '0';
-   isCommand = '0';
    prevButtonInput = '0';
-   rawButtonInput = '0';
    buttonInput = '0';
+   buttonRead = '0';
    //inBuffer = (volatile unsigned char * ) malloc(IN_BUFFER_SIZE);
    //fillWithNulls(inBuffer);
    //prevInput = 0b00000000;
@@ -252,6 +229,9 @@ int main(void)
    initTimer1();
    sei();
    initDisplay();
+   clearTrace(plotRows);
+   clearTrace(shownRows);
+   plotWindowInit(&demoWindow, X_MIN, X_MAX, YMIN, YMAX, SCREEN_WIDTH, SCREEN_HEIGHT);
 //    char prevMode = 'c';
    int mode = 0;
 //    char altFunction = '0';
@@ -260,7 +240,7 @@ int main(void)
 //    char specialFunctionPasted = '0';
 //    int currentSpecFuncType = -1;
    //textCursorPos = drawCommandLine(textBuffer, textCursorPos);
-   while (1) {
+   while (HAL_KEEP_RUNNING()) {
       if ((buttonInput == '1') && (buttonRead == '0')) {
          buttonRead = '1';
          if (mode < 2) {
@@ -281,83 +261,141 @@ int main(void)
          }
       }
    }
+   return 0;
 }
 
 int drawParabola() {
-   clearDisplay();
-   double xStepSize = ((X_MAX-X_MIN) / SCREEN_WIDTH);
-   double x = X_MIN;
-   while (x < X_XMAX) {
-      double y = (x*x);
-      double invertedY = (YMAX - y);
-      if ((invertedY <= YMAX) && (invertedY >= YMIN)) {
-         int scaledY = ((int) (invertedY * SCREEN_HEIGHT)));
-         int scaledX = ((int) ((x - X_MIN);
-         drawPoint(scaledX, scaledY);
-      }
-      x += xStepSize;
+   beginPlot();
+   fixed_t x = demoWindow.xStart;
+   int col;
+   for (col = 0; col < SCREEN_WIDTH; col++) {
+      drawPoint(col, plotRowForY(&demoWindow, fixedMul(x, x)));
+      x += demoWindow.xStep;
+      HAL_CYCLES(CYCLES_LONG_OP);
    }
+   endPlot();
    return 0;
 }
 
 int drawNegLine() {
-   clearDisplay();
-   double xStepSize = ((X_MAX-X_MIN) / SCREEN_WIDTH);
-   double x = X_MIN;
-   while (x < X_XMAX) {
-      double y = (-1.0 * x);
-      double invertedY = (YMAX - y);
-      if ((invertedY <= YMAX) && (invertedY >= YMIN)) {
-         int scaledY = ((int) (invertedY * SCREEN_HEIGHT)));
-         int scaledX = ((int) ((x - X_MIN);
-         drawPoint(scaledX, scaledY);
-      }
-      x += xStepSize;
+   beginPlot();
+   fixed_t x = demoWindow.xStart;
+   int col;
+   for (col = 0; col < SCREEN_WIDTH; col++) {
+      drawPoint(col, plotRowForY(&demoWindow, -x));
+      x += demoWindow.xStep;
+      HAL_CYCLES(2 * CYCLES_LONG_OP);
    }
+   endPlot();
    return 0;
 }
 
 int drawPosLine() {
-   clearDisplay();
-   double xStepSize = ((X_MAX-X_MIN) / SCREEN_WIDTH);
-   double x = X_MIN;
-   while (x < X_XMAX) {
-      double y = x;
-      double invertedY = (YMAX - y);
-      if ((invertedY <= YMAX) && (invertedY >= YMIN)) {
-         int scaledY = ((int) (invertedY * SCREEN_HEIGHT)));
-         int scaledX = ((int) ((x - X_MIN);
-         drawPoint(scaledX, scaledY);
+   beginPlot();
+   fixed_t x = demoWindow.xStart;
+   int col;
+   for (col = 0; col < SCREEN_WIDTH; col++) {
+      drawPoint(col, plotRowForY(&demoWindow, x));
+      x += demoWindow.xStep;
+      HAL_CYCLES(CYCLES_LONG_OP);
+   }
+   endPlot();
+   return 0;
+}
+
+// one bytecode evaluation per column; columns where the expression is undefined stay empty.
+// x steps in Q16.16 like the other curves and is only converted for the evaluation.
+int drawExpression(const CompiledExpression *expression)
+{
+   beginPlot();
+   fixed_t x = demoWindow.xStart;
+   int col;
+   for (col = 0; col < SCREEN_WIDTH; col++) {
+      double y = evaluateExpression(expression, fixedToDouble(x));
+      HAL_CYCLES(CYCLES_FLOAT_CMP);
+      if (y == y) {   // false for NaN
+         drawPoint(col, plotRowForValue(&demoWindow, y));
       }
-      x += xStepSize;
+      x += demoWindow.xStep;
+      HAL_CYCLES(CYCLES_LONG_OP);
    }
+   endPlot();
    return 0;
 }
 
-int drawPoint(scaledX, scaledY)
+// points are collected per column and rendered band by band in endPlot(), joined to their
+// neighbours; scaledY may also be FRAME_ROW_ABOVE or FRAME_ROW_BELOW for a point off the window
+int drawPoint(int scaledX, int scaledY)
 {
-   
+   if ((scaledX < 0) || (scaledX >= SCREEN_WIDTH)) {
+      return 0;
+   }
+   if (((scaledY >= 0) && (scaledY < SCREEN_HEIGHT)) || (scaledY == FRAME_ROW_ABOVE) || (scaledY == FRAME_ROW_BELOW)) {
+      plotRows[scaledX] = (unsigned char) scaledY;
+   }
+   return 0;
+}
+
+int clearTrace(unsigned char *rows)
+{
+   int i;
+   for (i = 0; i < SCREEN_WIDTH; i++) {
+      rows[i] = FRAME_NO_ROW;
+   }
+   return 0;
+}
+
+int beginPlot()
+{
+   clearTrace(plotRows);
+   return 0;
+}
+
+// replaces the curve on screen with the collected one, sending only the bytes that change
+int endPlot()
+{
+   int i;
+   frameDrawTrace(plotRows, shownRows);
+   for (i = 0; i < SCREEN_WIDTH; i++) {
+      shownRows[i] = plotRows[i];
+   }
+   return 0;
+}
 
 int initDisplay()
 {
+   busProfileBegin(BUS_OP_INIT);
    systemSet();
+   flushDisplayQueue();
    _delay_ms(5);
    setScroll();
+   flushDisplayQueue();
    _delay_ms(5);
    setHDOT_SCR();
+   flushDisplayQueue();
    _delay_ms(5);
    setOverlay();
+   flushDisplayQueue();
    _delay_ms(5);
    setDispState('0');
+   flushDisplayQueue();
+   _delay_ms(5);
+   setCursorDirection();
+   flushDisplayQueue();
    _delay_ms(5);
    clearAllDisplayMemory();
+   flushDisplayQueue();
    _delay_ms(5);
    setCSRW();
+   flushDisplayQueue();
    _delay_ms(5);
    setCSRForm();
+   flushDisplayQueue();
    _delay_ms(5);
    setDispState('1');
+   flushDisplayQueue();
    _delay_ms(5);
+   busProfileEnd();
    return 0;
 }
 
@@ -416,25 +454,23 @@ int setDispState(char on)
 
 int clearAllDisplayMemory()
 {
-   unsigned char i;
-   unsigned char j;
-   for (i = 0; i < 0b11111111; i++) {
-      for (j = 0; j < 0b01111111; j++) {
-         sendByteToDisplay(C_CSRW, '1');
-         sendByteToDisplay(i, '0');
-         sendByteToDisplay(j, '0');
-         sendByteToDisplay(C_MEMWRITE, '1');
-         sendByteToDisplay(0b00000000, '0');
-      }
-   }
+   busProfileBegin(BUS_OP_CLEAR);
+   beginDirectMode();
+   fillDisplayMemory(0x0000, 0b00000000, DISPLAY_MEMORY_SIZE);
+   endDirectMode();
+   busProfileEnd();
+   return 0;
+}
+
+int clearDisplay()
+{
+   clearAllDisplayMemory();
    return 0;
 }
 
 int setCSRW()
 {
-   sendByteToDisplay(C_CSRW, '1');
-   sendByteToDisplay(0b00000000, '0');
-   sendByteToDispay(0b00000000, '0');
+   setCursorAddress(0x0000);
    return 0;
 }
 
@@ -445,16 +481,3 @@ int setCSRForm()
    sendByteToDisplay(P_CSRFORM_P2_SMALL, '0');
    return 0;
 }
-
-int sendByteToDisplay(unsigned char currentByte, char currentIsCommand)
-{
-   isCommand = currentIsCommand;
-   byteToSend = currentByte;
-   byteAwaitingTransmission = '1';
-   while (byteAwaitingTransmission == '1') {
-      _delay_us(1);
-   }
-   return 0;
-}      
-   
-   
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef DISPLAY_HAL_H
+#define DISPLAY_HAL_H
+
+// [Hardware Abstraction Layer]
+//    Everything the firmware needs from the AVR toolchain goes through this header so the same
+//    source can be built for the board or linked against the SED1335 model (SED1335Sim.c) on a
+//    Linux host. The firmware keeps writing PORTB/PORTD and declaring ISR()s exactly as before.
+//    > AVR build: plain avr-libc includes, all HAL_ hooks compile to nothing
+//    > host build (-DHOST_BUILD): registers are simulated variables, delays advance simulated
+//      time and fire the timer ISRs, HAL_BUS_STROBE() hands the current pin state to the model and
+//      HAL_CYCLES() charges the estimated AVR cycle cost of the code it annotates
+//    Tables that only need reading are declared PROGMEM and read with pgm_read_byte(), so they stay
+//    in flash on the board. On the host they are ordinary memory in a .progmem section, which
+//    `make sram-report` leaves out.
+
+#ifndef F_CPU
+   #define F_CPU 16000000UL   // 16 MHz crystal (the display clock is derived from it by Timer0, see DisplayBus.h)
+#endif
+
+#ifndef HOST_BUILD
+
+   #include <avr/io.h>
+   #include <avr/interrupt.h>
+   #include <avr/pgmspace.h>
+   #include <util/delay.h>
+
+   #define HAL_BUS_STROBE()      // the display latches the pins on the clock edge by itself
+   #define HAL_CYCLES(cycles)    // cycle annotations only feed the host model
+   #define HAL_KEEP_RUNNING() 1  // firmware main loops never exit on the board
+
+#else
+
+   #include "SED1335Sim.h"
+
+   // simulated I/O registers (defined in SED1335Sim.c)
+   extern volatile unsigned char PORTB;
+   extern volatile unsigned char PORTD;
+   extern volatile unsigned char PINB;
+   extern volatile unsigned char DDRB;
+   extern volatile unsigned char DDRD;
+   extern volatile unsigned char TCCR0A;
+   extern volatile unsigned char TCCR0B;
+   extern volatile unsigned char TIMSK0;
+   extern volatile unsigned char OCR0A;
+   extern volatile unsigned char TCNT0;
+   extern volatile unsigned char TCCR1B;
+   extern volatile unsigned char TIMSK1;
+   extern volatile unsigned int OCR1A;
+   extern volatile unsigned int TCNT1;
+   extern volatile unsigned char TIFR1;
+   extern volatile unsigned char PCICR;
+   extern volatile unsigned char PCMSK1;
+
+   // register bit positions (same values as the ATmega328P headers)
+   #define WGM01 1
+   #define CS00 0
+   #define CS01 1
+   #define CS02 2
+   #define OCIE0A 1
+   #define WGM12 3
+   #define CS10 0
+   #define CS11 1
+   #define CS12 2
+   #define OCIE1A 1
+   #define TOIE1 0
+   #define OCF1A 1
+   #define PCIE1 1
+
+   // interrupt vectors become plain functions that the simulator calls on timer compare matches
+   #define ISR(vector) void vector(void)
+   void TIMER0_COMPA_vect(void);
+   void TIMER1_COMPA_vect(void);
+
+   #define sei() simSetInterrupts('1')
+   #define cli() simSetInterrupts('0')
+   #define _delay_us(us) simDelayUs((double) (us))
+   #define _delay_ms(ms) simDelayUs(((double) (ms)) * 1000.0)
+
+   #define PROGMEM __attribute__((section(".progmem.data")))
+   #define PSTR(text) (__extension__({ static const char flashText[] PROGMEM = (text); &flashText[0]; }))
+   #define pgm_read_byte(address) (*(const unsigned char *) (address))
+
+   #define HAL_BUS_STROBE() simBusStrobe()
+   #define HAL_CYCLES(cycles) simChargeCycles(cycles)
+   #define HAL_KEEP_RUNNING() simKeepRunning()
+
+   // the host harness owns main(), so the firmware entry point is renamed (host-side programs
+   // that include this header for HAL_CYCLES/F_CPU define HOST_PROGRAM first to keep their main)
+   #ifndef HOST_PROGRAM
+      #define main firmwareMain
+   #endif
+   int firmwareMain(void);
+
+#endif
+
+#endif
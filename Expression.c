@@ -0,0 +1,714 @@
+#include <math.h>
+#include "DisplayHAL.h"
+#include "PlotWindow.h"
+#include "Expression.h"
+
+#define EXPR_DISPATCH_CYCLES 14   // opcode fetch, jump table dispatch, stack pointer update
+
+// in flash (PROGMEM), like every name matchName() looks for
+typedef struct {
+   char name[5];
+   unsigned char opcode;
+} ExpressionFunction;
+
+static const ExpressionFunction expressionFunctions[] PROGMEM = {
+   {"asin", OP_ASIN}, {"acos", OP_ACOS}, {"atan", OP_ATAN},
+   {"sin", OP_SIN}, {"cos", OP_COS}, {"tan", OP_TAN},
+   {"sqrt", OP_SQRT}, {"ln", OP_LN}, {"log", OP_LOG}, {"exp", OP_EXP}, {"abs", OP_ABS}
+};
+#define EXPR_FUNCTION_COUNT (sizeof(expressionFunctions) / sizeof(expressionFunctions[0]))
+
+// compiler state, only live during compileExpression()
+static const char *parseText;
+static int parsePos;
+static CompiledExpression *parseOutput;
+static int parseDepth;
+static char parseFailed;
+
+static void parseExpression(void);
+
+void clearExpression(CompiledExpression *expression)
+{
+   expression->code[0] = OP_END;
+   expression->length = 0;
+   expression->constantCount = 0;
+   expression->valid = '0';
+}
+
+static void emitByte(unsigned char byte)
+{
+   if (parseOutput->length >= (EXPR_CODE_SIZE - 1)) {   // keep room for OP_END
+      parseFailed = '1';
+      return;
+   }
+   parseOutput->code[parseOutput->length] = byte;
+   parseOutput->length++;
+}
+
+// tracks the stack depth the bytecode will reach: pushes add one, binary operators remove one
+static void emitOp(unsigned char opcode)
+{
+   emitByte(opcode);
+   if ((opcode == OP_X) || (opcode == OP_CONST)) {
+      parseDepth++;
+      if (parseDepth > EXPR_STACK_SIZE) {
+         parseFailed = '1';
+      }
+   } else if ((opcode >= OP_ADD) && (opcode <= OP_POW)) {
+      parseDepth--;
+   }
+}
+
+static void emitConstant(double value)
+{
+   unsigned char index;
+   for (index = 0; index < parseOutput->constantCount; index++) {
+      if (parseOutput->constants[index] == value) {
+         break;
+      }
+   }
+   if (index == parseOutput->constantCount) {
+      if (parseOutput->constantCount >= EXPR_MAX_CONSTANTS) {
+         parseFailed = '1';
+         return;
+      }
+      parseOutput->constants[index] = value;
+      parseOutput->constantCount++;
+   }
+   emitOp(OP_CONST);
+   emitByte(index);
+}
+
+static char peekChar(void)
+{
+   while (parseText[parsePos] == ' ') {
+      parsePos++;
+   }
+   return parseText[parsePos];
+}
+
+static char isDigit(char c)
+{
+   if (((c >= '0') && (c <= '9')) || (c == '.')) {
+      return '1';
+   }
+   return '0';
+}
+
+static char isLetter(char c)
+{
+   if ((c >= 'a') && (c <= 'z')) {
+      return '1';
+   }
+   return '0';
+}
+
+// '1' if the text at the parse position starts with name (a string in flash)
+static char matchName(const char *name)
+{
+   int i = 0;
+   char c;
+   while ((c = (char) pgm_read_byte(&name[i])) != '\0') {
+      if (parseText[parsePos + i] != c) {
+         return '0';
+      }
+      i++;
+   }
+   parsePos += i;
+   return '1';
+}
+
+static void parseNumber(void)
+{
+   double value = 0;
+   double scale = 1;
+   char seenPoint = '0';
+   char seenDigit = '0';
+   while (isDigit(parseText[parsePos]) == '1') {
+      char c = parseText[parsePos];
+      if (c == '.') {
+         if (seenPoint == '1') {
+            parseFailed = '1';
+            return;
+         }
+         seenPoint = '1';
+      } else if (seenPoint == '1') {
+         scale /= 10;
+         value += ((c - '0') * scale);
+         seenDigit = '1';
+      } else {
+         value = ((value * 10) + (c - '0'));
+         seenDigit = '1';
+      }
+      parsePos++;
+   }
+   if (seenDigit == '0') {
+      parseFailed = '1';
+      return;
+   }
+   emitConstant(value);
+}
+
+static void parseParenthesized(void)
+{
+   if (peekChar() != '(') {
+      parseFailed = '1';
+      return;
+   }
+   parsePos++;
+   parseExpression();
+   if (peekChar() != ')') {
+      parseFailed = '1';
+      return;
+   }
+   parsePos++;
+}
+
+static void parsePrimary(void)
+{
+   char c = peekChar();
+   if (isDigit(c) == '1') {
+      parseNumber();
+      return;
+   }
+   if (c == '(') {
+      parseParenthesized();
+      return;
+   }
+   unsigned int i;
+   for (i = 0; i < EXPR_FUNCTION_COUNT; i++) {
+      if (matchName(expressionFunctions[i].name) == '1') {
+         parseParenthesized();
+         emitOp(pgm_read_byte(&expressionFunctions[i].opcode));
+         return;
+      }
+   }
+   if (matchName(PSTR("pi")) == '1') {
+      emitConstant(M_PI);
+   } else if (matchName(PSTR("x")) == '1') {
+      emitOp(OP_X);
+   } else if (matchName(PSTR("e")) == '1') {
+      emitConstant(M_E);
+   } else {
+      parseFailed = '1';
+   }
+}
+
+static void parseUnary(void);
+
+// a ^ b binds tighter than unary minus on its left (-x^2 = -(x^2)) and is right associative
+static void parsePower(void)
+{
+   parsePrimary();
+   if (peekChar() == '^') {
+      parsePos++;
+      parseUnary();
+      emitOp(OP_POW);
+   }
+}
+
+static void parseUnary(void)
+{
+   char c = peekChar();
+   if (c == '-') {
+      parsePos++;
+      parseUnary();
+      emitOp(OP_NEG);
+   } else if (c == '+') {
+      parsePos++;
+      parseUnary();
+   } else {
+      parsePower();
+   }
+}
+
+static void parseTerm(void)
+{
+   parseUnary();
+   while (parseFailed == '0') {
+      char c = peekChar();
+      if ((c == '*') || (c == '/')) {
+         parsePos++;
+         parseUnary();
+         emitOp((c == '*') ? OP_MUL : OP_DIV);
+      } else if ((isDigit(c) == '1') || (isLetter(c) == '1') || (c == '(')) {
+         parsePower();   // implicit multiplication
+         emitOp(OP_MUL);
+      } else {
+         break;
+      }
+   }
+}
+
+static void parseExpression(void)
+{
+   parseTerm();
+   while (parseFailed == '0') {
+      char c = peekChar();
+      if ((c != '+') && (c != '-')) {
+         break;
+      }
+      parsePos++;
+      parseTerm();
+      emitOp((c == '+') ? OP_ADD : OP_SUB);
+   }
+}
+
+// returns '1' and fills expression with the unoptimized bytecode if text is a complete
+// expression, '0' (expression cleared) otherwise
+char parseExpressionText(const char *text, CompiledExpression *expression)
+{
+   clearExpression(expression);
+   parseText = text;
+   parsePos = 0;
+   parseOutput = expression;
+   parseDepth = 0;
+   parseFailed = '0';
+   if (peekChar() == '\0') {
+      return '0';
+   }
+   parseExpression();
+   if ((parseFailed == '1') || (peekChar() != '\0')) {
+      clearExpression(expression);
+      return '0';
+   }
+   expression->code[expression->length] = OP_END;
+   expression->valid = '1';
+   return '1';
+}
+
+// [Optimizer]
+//    Walks the bytecode once while keeping, for every value on the (symbolic) stack, where its
+//    code starts in the output and whether it is a known constant (whose code is then the single
+//    OP_CONST there, so its value is read back from the pool). Because postfix operands are
+//    contiguous and adjacent, folding an operator is a truncation of the output back to its first
+//    operand followed by a single OP_CONST.
+
+typedef struct {
+   unsigned char start;   // output offset of the code computing this value
+   char constant;         // '1' if the value is known at compile time
+} OptimizerEntry;
+
+static CompiledExpression optimizerOutput;
+static OptimizerEntry optimizerStack[EXPR_STACK_SIZE];
+static int optimizerTop;
+static char optimizerFailed;
+
+static void optimizerEmit(unsigned char byte)
+{
+   if (optimizerOutput.length >= (EXPR_CODE_SIZE - 1)) {
+      optimizerFailed = '1';
+      return;
+   }
+   optimizerOutput.code[optimizerOutput.length] = byte;
+   optimizerOutput.length++;
+}
+
+// rebuilds the pool from the constants the output still references: operands that were folded
+// were truncated away from the code, but their entries stay in the pool until this runs
+static void optimizerCompactConstants(void)
+{
+   double constants[EXPR_MAX_CONSTANTS];
+   unsigned char count = 0;
+   int i;
+   for (i = 0; i < optimizerOutput.length; i++) {
+      if (optimizerOutput.code[i] == OP_CONST) {
+         i++;
+         double value = optimizerOutput.constants[optimizerOutput.code[i]];
+         unsigned char index;
+         for (index = 0; index < count; index++) {
+            if (constants[index] == value) {
+               break;
+            }
+         }
+         if (index == count) {
+            constants[count] = value;
+            count++;
+         }
+         optimizerOutput.code[i] = index;
+      }
+   }
+   for (i = 0; i < count; i++) {
+      optimizerOutput.constants[i] = constants[i];
+   }
+   optimizerOutput.constantCount = count;
+}
+
+static void optimizerEmitConstant(double value)
+{
+   unsigned char index;
+   for (index = 0; index < optimizerOutput.constantCount; index++) {
+      if (optimizerOutput.constants[index] == value) {
+         break;
+      }
+   }
+   if (index == optimizerOutput.constantCount) {
+      if (optimizerOutput.constantCount >= EXPR_MAX_CONSTANTS) {
+         optimizerCompactConstants();
+         index = optimizerOutput.constantCount;   // value was not in the pool before compacting
+      }
+      if (index >= EXPR_MAX_CONSTANTS) {
+         optimizerFailed = '1';
+         return;
+      }
+      optimizerOutput.constants[index] = value;
+      optimizerOutput.constantCount++;
+   }
+   optimizerEmit(OP_CONST);
+   optimizerEmit(index);
+}
+
+// replaces the output from start on with one constant and pushes it
+static void optimizerPushConstant(unsigned char start, double value)
+{
+   optimizerOutput.length = start;
+   optimizerEmitConstant(value);
+   optimizerTop++;
+   optimizerStack[optimizerTop].start = start;
+   optimizerStack[optimizerTop].constant = '1';
+}
+
+// value of a constant entry: the pool entry its OP_CONST names (compacting the pool rewrites the
+// index along with the entry)
+static double entryValue(const OptimizerEntry *entry)
+{
+   return optimizerOutput.constants[optimizerOutput.code[entry->start + 1]];
+}
+
+static void optimizerPushComputed(unsigned char start)
+{
+   optimizerTop++;
+   optimizerStack[optimizerTop].start = start;
+   optimizerStack[optimizerTop].constant = '0';
+}
+
+// removes the code of operand a (which directly precedes operand b) from the output
+static void optimizerDropFirstOperand(const OptimizerEntry *a, const OptimizerEntry *b)
+{
+   unsigned char shift = (b->start - a->start);
+   unsigned char i;
+   for (i = b->start; i < optimizerOutput.length; i++) {
+      optimizerOutput.code[i - shift] = optimizerOutput.code[i];
+   }
+   optimizerOutput.length -= shift;
+}
+
+// base^n for the value on top of the stack, by squaring: n even = (base^(n/2))^2,
+// n odd = base * base^(n-1)
+static void optimizerEmitPowerChain(int n)
+{
+   if (n <= 1) {
+      return;
+   }
+   if ((n % 2) == 0) {
+      optimizerEmitPowerChain(n / 2);
+      optimizerEmit(OP_DUP);
+      optimizerEmit(OP_MUL);
+   } else {
+      optimizerEmit(OP_DUP);
+      optimizerEmitPowerChain(n - 1);
+      optimizerEmit(OP_MUL);
+   }
+}
+
+static double foldOperator(unsigned char opcode, double a, double b)
+{
+   switch (opcode) {
+      case OP_ADD: return (a + b);
+      case OP_SUB: return (a - b);
+      case OP_MUL: return (a * b);
+      case OP_DIV: return (a / b);
+      case OP_POW: return pow(a, b);
+      case OP_NEG: return -a;
+      case OP_SIN: return sin(a);
+      case OP_COS: return cos(a);
+      case OP_TAN: return tan(a);
+      case OP_ASIN: return asin(a);
+      case OP_ACOS: return acos(a);
+      case OP_ATAN: return atan(a);
+      case OP_SQRT: return sqrt(a);
+      case OP_LN: return log(a);
+      case OP_LOG: return log10(a);
+      case OP_EXP: return exp(a);
+      case OP_ABS: return fabs(a);
+   }
+   return NAN;
+}
+
+static void optimizeBinary(unsigned char opcode)
+{
+   OptimizerEntry b = optimizerStack[optimizerTop--];
+   OptimizerEntry a = optimizerStack[optimizerTop--];
+   double aValue = ((a.constant == '1') ? entryValue(&a) : 0);
+   double bValue = ((b.constant == '1') ? entryValue(&b) : 0);
+   if ((a.constant == '1') && (b.constant == '1')) {
+      optimizerPushConstant(a.start, foldOperator(opcode, aValue, bValue));
+      return;
+   }
+   if (b.constant == '1') {
+      if ((((opcode == OP_ADD) || (opcode == OP_SUB)) && (bValue == 0))
+          || (((opcode == OP_MUL) || (opcode == OP_DIV) || (opcode == OP_POW)) && (bValue == 1))) {
+         optimizerOutput.length = b.start;   // u + 0, u - 0, u * 1, u / 1, u ^ 1
+         optimizerPushComputed(a.start);
+         return;
+      }
+      if ((opcode == OP_DIV) && (bValue != 0)) {
+         optimizerOutput.length = b.start;
+         optimizerEmitConstant(1 / bValue);
+         optimizerEmit(OP_MUL);
+         optimizerPushComputed(a.start);
+         return;
+      }
+      if ((opcode == OP_POW) && (bValue == 0)) {
+         optimizerPushConstant(a.start, 1);
+         return;
+      }
+      if ((opcode == OP_POW) && (bValue == 0.5)) {
+         optimizerOutput.length = b.start;
+         optimizerEmit(OP_SQRT);
+         optimizerPushComputed(a.start);
+         return;
+      }
+      if ((opcode == OP_POW) && (bValue == ((int) bValue)) && (bValue > 1) && (bValue <= EXPR_MAX_POWER_CHAIN)) {
+         optimizerOutput.length = b.start;
+         optimizerEmitPowerChain((int) bValue);
+         optimizerPushComputed(a.start);
+         return;
+      }
+   }
+   if (a.constant == '1') {
+      if (((opcode == OP_ADD) && (aValue == 0)) || ((opcode == OP_MUL) && (aValue == 1))) {
+         optimizerDropFirstOperand(&a, &b);   // 0 + u, 1 * u
+         optimizerPushComputed(a.start);
+         return;
+      }
+      if ((opcode == OP_POW) && (aValue > 0)) {
+         double logBase = log(aValue);   // c^u = exp(u * ln c), ln c computed once
+         optimizerDropFirstOperand(&a, &b);
+         if (logBase != 1) {
+            optimizerEmitConstant(logBase);
+            optimizerEmit(OP_MUL);
+         }
+         optimizerEmit(OP_EXP);
+         optimizerPushComputed(a.start);
+         return;
+      }
+   }
+   optimizerEmit(opcode);
+   optimizerPushComputed(a.start);
+}
+
+static void optimizeUnary(unsigned char opcode)
+{
+   OptimizerEntry a = optimizerStack[optimizerTop--];
+   if (a.constant == '1') {
+      optimizerPushConstant(a.start, foldOperator(opcode, entryValue(&a), 0));
+      return;
+   }
+   optimizerEmit(opcode);
+   optimizerPushComputed(a.start);
+}
+
+// deepest stack the bytecode reaches
+static int measureStackDepth(const CompiledExpression *expression)
+{
+   int depth = 0;
+   int deepest = 0;
+   int i;
+   for (i = 0; i < expression->length; i++) {
+      unsigned char opcode = expression->code[i];
+      if ((opcode == OP_X) || (opcode == OP_CONST) || (opcode == OP_DUP)) {
+         depth++;
+         if (opcode == OP_CONST) {
+            i++;
+         }
+      } else if ((opcode >= OP_ADD) && (opcode <= OP_POW)) {
+         depth--;
+      }
+      if (depth > deepest) {
+         deepest = depth;
+      }
+   }
+   return deepest;
+}
+
+// rewrites expression in place; returns '1' if it changed it. If the rewritten code would not
+// fit (code size, constant pool, stack) the expression is left as it was.
+char optimizeExpression(CompiledExpression *expression)
+{
+   int i;
+   if (expression->valid != '1') {
+      return '0';
+   }
+   clearExpression(&optimizerOutput);
+   optimizerTop = -1;
+   optimizerFailed = '0';
+   for (i = 0; (i < expression->length) && (optimizerFailed == '0'); i++) {
+      unsigned char opcode = expression->code[i];
+      unsigned char start = optimizerOutput.length;
+      if (opcode == OP_X) {
+         optimizerEmit(OP_X);
+         optimizerPushComputed(start);
+      } else if (opcode == OP_CONST) {
+         i++;
+         optimizerPushConstant(start, expression->constants[expression->code[i]]);
+      } else if ((opcode >= OP_ADD) && (opcode <= OP_POW)) {
+         optimizeBinary(opcode);
+      } else {
+         optimizeUnary(opcode);
+      }
+   }
+   if ((optimizerFailed == '1') || (measureStackDepth(&optimizerOutput) > EXPR_STACK_SIZE)) {
+      return '0';
+   }
+   optimizerCompactConstants();
+   optimizerOutput.code[optimizerOutput.length] = OP_END;
+   optimizerOutput.valid = '1';
+   *expression = optimizerOutput;
+   return '1';
+}
+
+// parse and optimize
+char compileExpression(const char *text, CompiledExpression *expression)
+{
+   if (parseExpressionText(text, expression) == '0') {
+      return '0';
+   }
+   optimizeExpression(expression);
+   return '1';
+}
+
+// '1' if both run the same bytecode over the same constants (bytes past OP_END are not compared)
+char expressionsEqual(const CompiledExpression *a, const CompiledExpression *b)
+{
+   int i;
+   if ((a->valid != b->valid) || (a->length != b->length) || (a->constantCount != b->constantCount)) {
+      return '0';
+   }
+   for (i = 0; i < a->length; i++) {
+      if (a->code[i] != b->code[i]) {
+         return '0';
+      }
+   }
+   for (i = 0; i < a->constantCount; i++) {
+      if (a->constants[i] != b->constants[i]) {
+         return '0';
+      }
+   }
+   return '1';
+}
+
+double evaluateExpression(const CompiledExpression *expression, double x)
+{
+   double stack[EXPR_STACK_SIZE];
+   int top = -1;
+   const unsigned char *pc = expression->code;
+   if (expression->valid != '1') {
+      return NAN;
+   }
+   while (1) {
+      HAL_CYCLES(EXPR_DISPATCH_CYCLES);
+      switch (*pc++) {
+         case OP_END:
+            return stack[top];
+         case OP_X:
+            stack[++top] = x;
+            break;
+         case OP_CONST:
+            stack[++top] = expression->constants[*pc++];
+            break;
+         case OP_ADD:
+            top--;
+            stack[top] += stack[top + 1];
+            HAL_CYCLES(CYCLES_FLOAT_ADD);
+            break;
+         case OP_SUB:
+            top--;
+            stack[top] -= stack[top + 1];
+            HAL_CYCLES(CYCLES_FLOAT_ADD);
+            break;
+         case OP_MUL:
+            top--;
+            stack[top] *= stack[top + 1];
+            HAL_CYCLES(CYCLES_FLOAT_MUL);
+            break;
+         case OP_DIV:
+            top--;
+            stack[top] /= stack[top + 1];
+            HAL_CYCLES(CYCLES_FLOAT_DIV);
+            break;
+         case OP_POW:
+            top--;
+            stack[top] = pow(stack[top], stack[top + 1]);
+            HAL_CYCLES(CYCLES_FLOAT_POW);
+            break;
+         case OP_NEG:
+            stack[top] = -stack[top];
+            break;
+         case OP_SIN:
+            stack[top] = sin(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_COS:
+            stack[top] = cos(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_TAN:
+            stack[top] = tan(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_ASIN:
+            stack[top] = asin(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_ACOS:
+            stack[top] = acos(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_ATAN:
+            stack[top] = atan(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_TRIG);
+            break;
+         case OP_SQRT:
+            stack[top] = sqrt(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_SQRT);
+            break;
+         case OP_LN:
+            stack[top] = log(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_LOG);
+            break;
+         case OP_LOG:
+            stack[top] = log10(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_LOG);
+            break;
+         case OP_EXP:
+            stack[top] = exp(stack[top]);
+            HAL_CYCLES(CYCLES_FLOAT_LOG);
+            break;
+         case OP_ABS:
+            stack[top] = fabs(stack[top]);
+            break;
+         case OP_DUP:
+            stack[top + 1] = stack[top];
+            top++;
+            break;
+         default:
+            return NAN;
+      }
+   }
+}
+
+// operations executed per evaluation (an OP_CONST and its index byte count as one)
+int countInstructions(const CompiledExpression *expression)
+{
+   int count = 0;
+   int i = 0;
+   while (i < expression->length) {
+      if (expression->code[i] == OP_CONST) {
+         i++;
+      }
+      i++;
+      count++;
+   }
+   return count;
+}
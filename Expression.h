@@ -0,0 +1,67 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+// [Compiled Expressions]
+//    An equation is parsed once, when it is entered, into postfix bytecode: one opcode byte per
+//    operation, with numeric constants parsed into a small per-expression pool and referenced by
+//    index. Graphing and the command line then run the bytecode through evaluateExpression(),
+//    a single switch over a value stack, instead of re-reading the text for every sample.
+//
+//    Between parsing and evaluation, optimizeExpression() rewrites the bytecode: constant
+//    subexpressions are folded (x is the only variable, so everything that does not depend on it
+//    is computed once here instead of once per sample), small integer powers become multiply
+//    chains and u^0.5 becomes sqrt, division by a constant becomes multiplication by its
+//    reciprocal, and c^u becomes exp(u * ln c) with ln c precomputed. The constant pool is rebuilt
+//    from what the rewritten code references, so folded operands do not use up EXPR_MAX_CONSTANTS.
+//    Fewer cycles is the goal, not fewer instructions: a multiply chain or exp(u * ln c) runs more
+//    instructions than the OP_POW it replaces (x^3-2x^2+x-1 goes from 13 to 15, 2^x from 3 to 4).
+//
+//    Accepted text: numbers (digits with an optional '.'), x, pi, e, + - * / ^ (right
+//    associative), unary minus, parentheses, implicit multiplication ("2x", "3sin(x)", "(x+1)(x-1)")
+//    and the functions listed in the opcode table.
+
+#define EXPR_CODE_SIZE 32        // bytecode bytes per expression, including OP_END
+#define EXPR_MAX_CONSTANTS 8     // distinct numeric constants per expression
+#define EXPR_STACK_SIZE 12       // evaluation stack entries (deepest nesting accepted)
+#define EXPR_MAX_POWER_CHAIN 16  // largest integer exponent turned into multiplications
+
+// opcodes (postfix: operands are on the stack, results are pushed back)
+   #define OP_END 0              // stop, the result is on top of the stack
+   #define OP_X 1                // push x
+   #define OP_CONST 2            // push constants[next byte]
+   #define OP_ADD 3
+   #define OP_SUB 4
+   #define OP_MUL 5
+   #define OP_DIV 6
+   #define OP_POW 7
+   #define OP_NEG 8
+   #define OP_SIN 9
+   #define OP_COS 10
+   #define OP_TAN 11
+   #define OP_ASIN 12
+   #define OP_ACOS 13
+   #define OP_ATAN 14
+   #define OP_SQRT 15
+   #define OP_LN 16
+   #define OP_LOG 17
+   #define OP_EXP 18
+   #define OP_ABS 19
+   #define OP_DUP 20             // push a copy of the top entry (multiply chains)
+
+typedef struct {
+   unsigned char code[EXPR_CODE_SIZE];       // postfix bytecode, terminated by OP_END
+   double constants[EXPR_MAX_CONSTANTS];     // numbers parsed out of the text
+   unsigned char length;                     // bytecode bytes before OP_END
+   unsigned char constantCount;
+   char valid;                               // '1' once compiled, '0' for an empty or rejected text
+} CompiledExpression;
+
+void clearExpression(CompiledExpression *expression);
+char parseExpressionText(const char *text, CompiledExpression *expression);
+char optimizeExpression(CompiledExpression *expression);
+char compileExpression(const char *text, CompiledExpression *expression);
+char expressionsEqual(const CompiledExpression *a, const CompiledExpression *b);
+double evaluateExpression(const CompiledExpression *expression, double x);
+int countInstructions(const CompiledExpression *expression);
+
+#endif
@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include "SED1335Sim.h"
+#include "Expression.h"
+
+// [Expression Optimizer Benchmark]
+//    Compiles a corpus of equations as they tend to be typed on the keypad, with and without the
+//    optimizer pass, and reports the instructions executed per evaluation and the modelled AVR
+//    cycles for a full 320-column sweep of each, and the constant pool entries the result keeps.
+//    Instructions can go up: u^n becomes a DUP/MUL chain and c^u becomes exp(u * ln c), more
+//    instructions than one OP_POW but each a fraction of pow()'s cost, so the cycles go down.
+
+#define BENCH_COLUMNS 320
+#define BENCH_X_MIN -10.0
+#define BENCH_X_MAX 10.0
+
+static const char *benchCorpus[] = {
+   "x^2",
+   "x^2/4-3",
+   "2*3.14159*x",
+   "x^3-2x^2+x-1",
+   "sin(2*pi/10*x)",
+   "3sin(x)+cos(x)/2",
+   "e^(-x^2/2)/sqrt(2pi)",
+   "2^x",
+   "(x+1)(x-1)/(2*2)",
+   "x^0.5",
+   "1/x",
+   "tan(x)",
+   "2*3*4*5*6*7*x"      // folds through more constants than the pool holds
+};
+#define BENCH_CORPUS_SIZE (sizeof(benchCorpus) / sizeof(benchCorpus[0]))
+
+// keypad polling is not part of this benchmark
+void TIMER1_COMPA_vect(void)
+{
+}
+
+static unsigned long long sweepCycles(const CompiledExpression *expression)
+{
+   double step = ((BENCH_X_MAX - BENCH_X_MIN) / BENCH_COLUMNS);
+   double x = BENCH_X_MIN;
+   int col;
+   unsigned long long before = simGetTotals().cpuCycles;
+   for (col = 0; col < BENCH_COLUMNS; col++) {
+      evaluateExpression(expression, x);
+      x += step;
+   }
+   return (simGetTotals().cpuCycles - before);
+}
+
+int main(void)
+{
+   CompiledExpression parsed;
+   CompiledExpression optimized;
+   int parsedTotal = 0;
+   int optimizedTotal = 0;
+   unsigned long long parsedCycles = 0;
+   unsigned long long optimizedCycles = 0;
+   unsigned int i;
+   simReset();
+   printf("\n%-24s %12s %24s %10s\n", "equation", "instructions", "cycles per 320 columns", "constants");
+   for (i = 0; i < BENCH_CORPUS_SIZE; i++) {
+      if (parseExpressionText(benchCorpus[i], &parsed) == '0') {
+         printf("%-24s rejected\n", benchCorpus[i]);
+         continue;
+      }
+      optimized = parsed;
+      optimizeExpression(&optimized);
+      int before = countInstructions(&parsed);
+      int after = countInstructions(&optimized);
+      unsigned long long cyclesBefore = sweepCycles(&parsed);
+      unsigned long long cyclesAfter = sweepCycles(&optimized);
+      printf("%-24s %5d -> %3d %11llu -> %9llu %5d -> %2d\n", benchCorpus[i], before, after, cyclesBefore,
+             cyclesAfter, parsed.constantCount, optimized.constantCount);
+      parsedTotal += before;
+      optimizedTotal += after;
+      parsedCycles += cyclesBefore;
+      optimizedCycles += cyclesAfter;
+   }
+   printf("%-24s %5d -> %3d %11llu -> %9llu  (%.2fx)\n\n", "total", parsedTotal, optimizedTotal,
+          parsedCycles, optimizedCycles, ((double) parsedCycles) / optimizedCycles);
+   return 0;
+}
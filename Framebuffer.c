@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+
+// [Display Commands Used By The Framebuffer]
+   #define C_SCROLL 0b01000100
+   #define P_SCROLL_P3_MONO 0b11101111    // screen block 1 size: 240 lines
+   #define C_OVERLAY 0b01011011
+   #define P_OVERLAY_TEXT 0b00000000      // 2 layers OR-ed, screen block 1 in text mode
+   #define P_OVERLAY_GRAPHICS 0b00000100  // 2 layers OR-ed, screen block 1 in graphics mode (DM1)
+
+// pixels of the current band, or of the current strip; the two are never drawn at the same time
+union {
+   unsigned char band[FRAME_BAND_ROWS][FRAME_BYTES_PER_ROW];
+   unsigned char strip[FRAME_HEIGHT];
+} framePixels;
+unsigned char frameDirty[FRAME_BAND_ROWS][FRAME_DIRTY_BYTES_PER_ROW]; // one bit per band byte to resend
+int frameBandFirstRow;                                               // screen row of band[0]
+int frameStripColumn = -1;                                           // byte column of the strip, -1 while drawing bands
+unsigned int frameDrawAddress = FRAME_LAYER_ADDRESS;                 // VRAM address of screen row 0, column 0 of the layer being drawn
+unsigned int frameScroll[4] = {0, FRAME_LAYER_ADDRESS, 0, 0};        // start addresses of screen blocks 1-4 (as setScroll() leaves them)
+int frameUpperLines = FRAME_HEIGHT;                                  // lines of blocks 1 and 2, the rest shows blocks 3 and 4
+
+// clears the band to the background and forgets any dirty bytes
+void frameBeginBand(int firstRow)
+{
+   int row;
+   int col;
+   frameBandFirstRow = firstRow;
+   frameStripColumn = -1;
+   for (row = 0; row < FRAME_BAND_ROWS; row++) {
+      for (col = 0; col < FRAME_BYTES_PER_ROW; col++) {
+         framePixels.band[row][col] = 0b00000000;
+      }
+      for (col = 0; col < FRAME_DIRTY_BYTES_PER_ROW; col++) {
+         frameDirty[row][col] = 0b00000000;
+      }
+   }
+   HAL_CYCLES(FRAME_BAND_ROWS * (FRAME_BYTES_PER_ROW + FRAME_DIRTY_BYTES_PER_ROW) * 2);   // st X+
+}
+
+// clears the strip (byte column byteColumn over the full height) to the background; a strip has
+// no dirty bits, frameFlushStrip() always sends it whole
+void frameBeginStrip(int byteColumn)
+{
+   int row;
+   frameStripColumn = byteColumn;
+   for (row = 0; row < FRAME_HEIGHT; row++) {
+      framePixels.strip[row] = 0b00000000;
+   }
+   HAL_CYCLES(FRAME_HEIGHT * 2);   // st X+
+}
+
+int frameGetBandFirstRow()
+{
+   return frameBandFirstRow;
+}
+
+// points outside the current band (or the screen) are ignored; bands only
+void frameSetPixel(int x, int y)
+{
+   int row = (y - frameBandFirstRow);
+   if ((x < 0) || (x >= FRAME_WIDTH) || (row < 0) || (row >= FRAME_BAND_ROWS)) {
+      return;
+   }
+   int col = (x >> 3);
+   framePixels.band[row][col] |= (0b10000000 >> (x & 0b00000111));
+   frameDirty[row][col >> 3] |= (1 << (col & 0b00000111));
+}
+
+// the byte holding (x, y) gets rewritten with whatever the band holds there (background if unset)
+void frameMarkDirty(int x, int y)
+{
+   int row = (y - frameBandFirstRow);
+   if ((x < 0) || (x >= FRAME_WIDTH) || (row < 0) || (row >= FRAME_BAND_ROWS)) {
+      return;
+   }
+   int col = (x >> 3);
+   frameDirty[row][col >> 3] |= (1 << (col & 0b00000111));
+}
+
+// sets rows top..bottom of column x in the strip (if x is one of its columns)
+static void applyStripSpan(int x, int top, int bottom, char draw)
+{
+   if ((x >> 3) != frameStripColumn) {
+      return;
+   }
+   if (top < 0) {
+      top = 0;
+   }
+   if (bottom >= FRAME_HEIGHT) {
+      bottom = (FRAME_HEIGHT - 1);
+   }
+   HAL_CYCLES(20);   // clipping
+   if (top > bottom) {
+      return;
+   }
+   unsigned char mask = (0b10000000 >> (x & 0b00000111));
+   int row;
+   if (draw == '1') {
+      for (row = top; row <= bottom; row++) {
+         framePixels.strip[row] |= mask;
+      }
+   }
+   HAL_CYCLES(6 * (bottom - top + 1));   // ld/or/st per row
+}
+
+// sets (draw = '1') or only marks dirty (draw = '0') rows top..bottom of column x, clipped to the band
+static void applySpan(int x, int top, int bottom, char draw)
+{
+   if ((x < 0) || (x >= FRAME_WIDTH)) {
+      return;
+   }
+   if (frameStripColumn >= 0) {
+      applyStripSpan(x, top, bottom, draw);
+      return;
+   }
+   int first = (top - frameBandFirstRow);
+   int last = (bottom - frameBandFirstRow);
+   if (first < 0) {
+      first = 0;
+   }
+   if (last >= FRAME_BAND_ROWS) {
+      last = (FRAME_BAND_ROWS - 1);
+   }
+   HAL_CYCLES(24);   // clipping
+   if (first > last) {
+      return;
+   }
+   int col = (x >> 3);
+   unsigned char mask = (0b10000000 >> (x & 0b00000111));
+   unsigned char dirtyMask = (1 << (col & 0b00000111));
+   int row;
+   for (row = first; row <= last; row++) {
+      if (draw == '1') {
+         framePixels.band[row][col] |= mask;
+      }
+      frameDirty[row][col >> 3] |= dirtyMask;
+   }
+   HAL_CYCLES(10 * (last - first + 1));   // ld/or/st of pixel and dirty bit per row
+}
+
+// integer line from (x0, y0) to (x1, y1), x0 <= x1, drawn as one vertical run per column
+// (run-slice): the run boundaries advance by a precomputed whole step plus an error term, so
+// there is no division per column. Rows may lie outside the screen; every run is clipped to
+// the current band (or strip).
+void frameDrawSegment(int x0, int y0, int x1, int y1, char draw)
+{
+   int top = ((y0 < y1) ? y0 : y1);
+   int bottom = ((y0 < y1) ? y1 : y0);
+   int bandFirst = frameBandFirstRow;
+   int bandLast = (frameBandFirstRow + FRAME_BAND_ROWS - 1);
+   int firstX = 0;
+   int lastX = (FRAME_WIDTH - 1);
+   if (frameStripColumn >= 0) {
+      bandFirst = 0;
+      bandLast = (FRAME_HEIGHT - 1);
+      firstX = (frameStripColumn * 8);
+      lastX = (firstX + 7);
+   }
+   HAL_CYCLES(30);   // bounds and rejection test
+   if ((bottom < bandFirst) || (top > bandLast) || (x1 < firstX) || (x0 > lastX)) {
+      return;
+   }
+   int dx = (x1 - x0);
+   if (dx == 0) {
+      applySpan(x0, top, bottom, draw);
+      return;
+   }
+   int dy = (bottom - top);
+   int sign = ((y1 < y0) ? -1 : 1);
+   // boundary between column i and i + 1 sits (2i + 1) * dy / (2 dx) rows from y0
+   int denominator = (2 * dx);
+   int whole = ((2 * dy) / denominator);
+   int fraction = ((2 * dy) % denominator);
+   int offset = (dy / denominator);
+   int error = (dy % denominator);
+   int runStart = 0;
+   int i;
+   for (i = 0; i <= dx; i++) {
+      int runEnd = ((i == dx) ? dy : offset);
+      if (runStart > runEnd) {
+         runStart = runEnd;   // shallow part: this column stays on the previous row
+      }
+      if (sign > 0) {
+         applySpan(x0 + i, y0 + runStart, y0 + runEnd, draw);
+      } else {
+         applySpan(x0 + i, y0 - runEnd, y0 - runStart, draw);
+      }
+      HAL_CYCLES(16);   // 16-bit run boundary step
+      runStart = (runEnd + 1);
+      offset += whole;
+      error += fraction;
+      if (error >= denominator) {
+         offset++;
+         error -= denominator;
+      }
+   }
+}
+
+// row used for drawing a trace entry: off-window samples sit a full screen beyond the edge, so
+// the segment towards them leaves the window nearly vertically
+static int segmentRow(unsigned char entry)
+{
+   if (entry == FRAME_ROW_ABOVE) {
+      return -FRAME_HEIGHT;
+   } else if (entry == FRAME_ROW_BELOW) {
+      return ((2 * FRAME_HEIGHT) - 1);
+   }
+   return entry;
+}
+
+// '1' if the samples in columns x and x + 1 of the trace are joined by a segment
+char frameSegmentJoins(const unsigned char *rows, const unsigned char *breaks, int x)
+{
+   unsigned char left = rows[x];
+   unsigned char right = rows[x + 1];
+   if ((left == FRAME_NO_ROW) || (right == FRAME_NO_ROW)) {
+      return '0';
+   }
+   if ((left >= FRAME_ROW_BELOW) && (right >= FRAME_ROW_BELOW)) {
+      return '0';   // both off the window: nothing to draw, or a jump straight across it
+   }
+   if (breaks != NULL) {
+      return (((breaks[x >> 3] & (1 << (x & 0b00000111))) != 0) ? '0' : '1');
+   }
+   int jump = (segmentRow(right) - segmentRow(left));
+   if ((jump > FRAME_JUMP_ROWS) || (jump < -FRAME_JUMP_ROWS)) {
+      if ((x > 0) && (rows[x - 1] != FRAME_NO_ROW)) {
+         int previous = (segmentRow(left) - segmentRow(rows[x - 1]));
+         if (((previous < 0) && (jump > 0)) || ((previous > 0) && (jump < 0))) {
+            return '0';
+         }
+      }
+   }
+   return '1';
+}
+
+// draws (or marks dirty, for erasing) the part of a trace that falls in the current band
+void frameDrawTraceBand(const unsigned char *rows, const unsigned char *breaks, char draw)
+{
+   frameDrawTraceColumns(rows, breaks, 0, draw, 0, FRAME_WIDTH - 1);
+}
+
+// as frameDrawTraceBand, limited to the pixels of columns firstX..lastX (plus whatever the
+// segment from firstX - 1 spills into neighbouring columns). rows[0] and bit 0 of breaks are
+// column origin, so the trace only has to hold columns firstX - 1..lastX + 1.
+void frameDrawTraceColumns(const unsigned char *rows, const unsigned char *breaks, int origin, char draw,
+                           int firstX, int lastX)
+{
+   int x;
+   if (firstX > 0) {
+      firstX--;
+   }
+   if (lastX >= FRAME_WIDTH) {
+      lastX = (FRAME_WIDTH - 1);
+   }
+   for (x = firstX; x <= lastX; x++) {
+      unsigned char row = rows[x - origin];
+      HAL_CYCLES(20);   // load the pair, test for a join
+      if (row < FRAME_HEIGHT) {
+         applySpan(x, row, row, draw);
+      }
+      if ((x < (FRAME_WIDTH - 1)) && (frameSegmentJoins(rows, breaks, x - origin) == '1')) {
+         frameDrawSegment(x, segmentRow(row), x + 1, segmentRow(rows[x + 1 - origin]), draw);
+      }
+   }
+}
+
+// '1' if the samples in columns x and x + 1 of an exact trace are joined by a segment
+static char exactSegmentJoins(const int *rows, const unsigned char *breaks, int x)
+{
+   int left = rows[x];
+   int right = rows[x + 1];
+   if ((left == FRAME_EXACT_NO_ROW) || (right == FRAME_EXACT_NO_ROW)) {
+      return '0';
+   }
+   if (((left < 0) && (right < 0)) || ((left >= FRAME_HEIGHT) && (right >= FRAME_HEIGHT))) {
+      return '0';   // beyond the same edge: nothing of it is on the layer
+   }
+   return (((breaks[x >> 3] & (1 << (x & 0b00000111))) != 0) ? '0' : '1');
+}
+
+// draws the pixels of columns firstX..lastX of an exact trace: every sample where it is and every
+// joined pair as a segment, clipped to the band or strip. rows[0] and bit 0 of breaks are column
+// origin; the trace holds columns firstX - 1..lastX + 1.
+void frameDrawExactTraceColumns(const int *rows, const unsigned char *breaks, int origin, char draw, int firstX,
+                                int lastX)
+{
+   int x;
+   for (x = (firstX - 1); x <= lastX; x++) {
+      int row = rows[x - origin];
+      HAL_CYCLES(24);   // load the pair (16-bit rows), test for a join
+      if ((row >= 0) && (row < FRAME_HEIGHT)) {
+         applySpan(x, row, row, draw);
+      }
+      if (exactSegmentJoins(rows, breaks, x - origin) == '1') {
+         frameDrawSegment(x, row, x + 1, rows[x + 1 - origin], draw);
+      }
+   }
+}
+
+// replaces the band's dirty bits: rows firstRow..lastRow are sent whole, all other rows only in
+// the byte columns set in columnMask (one bit per byte column, like a frameDirty row)
+void frameSetDirtyRegion(const unsigned char *columnMask, int firstRow, int lastRow)
+{
+   int row;
+   int col;
+   for (row = 0; row < FRAME_BAND_ROWS; row++) {
+      int screenRow = (frameBandFirstRow + row);
+      char wholeRow = (((screenRow >= firstRow) && (screenRow <= lastRow)) ? '1' : '0');
+      for (col = 0; col < FRAME_DIRTY_BYTES_PER_ROW; col++) {
+         frameDirty[row][col] = ((wholeRow == '1') ? 0b11111111 : columnMask[col]);
+      }
+   }
+}
+
+// sets the start addresses of screen block 1 (the text layer, or a second graphics layer) and
+// screen block 2 (the graphics layer), both over the full height
+void frameSetScroll(unsigned int block1Address, unsigned int block2Address)
+{
+   unsigned char params[5];
+   if (frameUpperLines != FRAME_HEIGHT) {
+      frameSetSplitScroll(block1Address, block2Address, FRAME_HEIGHT, frameScroll[2], frameScroll[3]);
+      return;
+   }
+   params[0] = (unsigned char) (block1Address & 0xFF);
+   params[1] = (unsigned char) (block1Address >> 8);
+   params[2] = P_SCROLL_P3_MONO;
+   params[3] = (unsigned char) (block2Address & 0xFF);
+   params[4] = (unsigned char) (block2Address >> 8);
+   sendCommandToDisplay(C_SCROLL, params, 5);
+   frameScroll[0] = block1Address;
+   frameScroll[1] = block2Address;
+}
+
+// divides the screen: the top upperLines lines show blocks 1 and 2 as frameSetScroll() does, the
+// lines below show block 3 (the lower part of layer 1, in text mode) and block 4 (the lower part
+// of layer 2). upperLines = FRAME_HEIGHT undoes the split.
+void frameSetSplitScroll(unsigned int block1Address, unsigned int block2Address, int upperLines,
+                         unsigned int block3Address, unsigned int block4Address)
+{
+   unsigned char params[10];
+   params[0] = (unsigned char) (block1Address & 0xFF);
+   params[1] = (unsigned char) (block1Address >> 8);
+   params[2] = (unsigned char) (upperLines - 1);
+   params[3] = (unsigned char) (block2Address & 0xFF);
+   params[4] = (unsigned char) (block2Address >> 8);
+   params[5] = (unsigned char) (upperLines - 1);
+   params[6] = (unsigned char) (block3Address & 0xFF);
+   params[7] = (unsigned char) (block3Address >> 8);
+   params[8] = (unsigned char) (block4Address & 0xFF);
+   params[9] = (unsigned char) (block4Address >> 8);
+   sendCommandToDisplay(C_SCROLL, params, 10);
+   frameScroll[0] = block1Address;
+   frameScroll[1] = block2Address;
+   frameScroll[2] = block3Address;
+   frameScroll[3] = block4Address;
+   frameUpperLines = upperLines;
+}
+
+// start address of screen block 1-4 as last set by frameSetScroll() or frameSetSplitScroll()
+unsigned int frameGetScroll(int block)
+{
+   return frameScroll[block - 1];
+}
+
+// '1' shows screen block 1 as graphics, OR-ed with block 2; '0' gives it back to the text layer
+void frameSetOverlay(char block1Graphics)
+{
+   unsigned char param = ((block1Graphics == '1') ? P_OVERLAY_GRAPHICS : P_OVERLAY_TEXT);
+   sendCommandToDisplay(C_OVERLAY, &param, 1);
+}
+
+// bands and strips are flushed to the layer whose row 0, column 0 is at address
+void frameSetDrawAddress(unsigned int address)
+{
+   frameDrawAddress = address;
+}
+
+unsigned int frameGetDrawAddress()
+{
+   return frameDrawAddress;
+}
+
+static char isDirty(int row, int col)
+{
+   if ((frameDirty[row][col >> 3] & (1 << (col & 0b00000111))) != 0) {
+      return '1';
+   }
+   return '0';
+}
+
+// sends every dirty run of the band and returns the number of bus bytes it took
+unsigned int frameFlushBand()
+{
+   unsigned int busBytes = 0;
+   int row;
+   for (row = 0; row < FRAME_BAND_ROWS; row++) {
+      int screenRow = (frameBandFirstRow + row);
+      if (screenRow >= FRAME_HEIGHT) {
+         break;
+      }
+      int col = 0;
+      HAL_CYCLES(FRAME_BYTES_PER_ROW * 8);   // dirty bit scan
+      while (col < FRAME_BYTES_PER_ROW) {
+         if (isDirty(row, col) == '0') {
+            col++;
+            continue;
+         }
+         // extend the run across short clean gaps, restarting the cursor would cost more
+         int runStart = col;
+         int runEnd = col;
+         int scan = (col + 1);
+         while ((scan < FRAME_BYTES_PER_ROW) && ((scan - runEnd) <= FRAME_RUN_MERGE_GAP)) {
+            if (isDirty(row, scan) == '1') {
+               runEnd = scan;
+            }
+            scan++;
+         }
+         unsigned int length = (unsigned int) (runEnd - runStart + 1);
+         writeDisplayMemory(frameDrawAddress + (screenRow * FRAME_BYTES_PER_ROW) + runStart,
+                            &framePixels.band[row][runStart], length);
+         busBytes += (4 + length);
+         col = (runEnd + 1);
+      }
+   }
+   return busBytes;
+}
+
+// sends the strip top to bottom under one C_MEMWRITE and returns the number of bus bytes it
+// took; the cursor must be advancing downwards (setCursorDirectionDown)
+unsigned int frameFlushStrip()
+{
+   return frameFlushStripRows(0, FRAME_HEIGHT - 1);
+}
+
+// as frameFlushStrip, for rows firstRow..lastRow of the strip only
+unsigned int frameFlushStripRows(int firstRow, int lastRow)
+{
+   unsigned int length = (unsigned int) (lastRow - firstRow + 1);
+   writeDisplayMemory(frameDrawAddress + (firstRow * FRAME_BYTES_PER_ROW) + frameStripColumn,
+                      &framePixels.strip[firstRow], length);
+   return (4 + length);
+}
+
+// draws the trace newRows over the screen that currently shows oldRows (either may be NULL)
+// and returns the number of bus bytes it took
+unsigned int frameDrawTrace(const unsigned char *newRows, const unsigned char *oldRows)
+{
+   unsigned int busBytes = 0;
+   int firstRow;
+   beginDirectMode();
+   for (firstRow = 0; firstRow < FRAME_HEIGHT; firstRow += FRAME_BAND_ROWS) {
+      frameBeginBand(firstRow);
+      if (oldRows != NULL) {
+         frameDrawTraceBand(oldRows, NULL, '0');
+      }
+      if (newRows != NULL) {
+         frameDrawTraceBand(newRows, NULL, '1');
+      }
+      busBytes += frameFlushBand();
+   }
+   endDirectMode();
+   return busBytes;
+}
@@ -0,0 +1,84 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+// [Graphics Framebuffer]
+//    The 320x240 1bpp graphics layer needs 9600 bytes, far more than the ATmega's SRAM, so it is
+//    rendered one band of FRAME_BAND_ROWS rows at a time. Pixels are set in the band buffer, every
+//    byte that has to change on screen is marked dirty, and frameFlushBand() sends only the dirty
+//    runs to VRAM (one C_CSRW + C_MEMWRITE per run, the bytes themselves by auto-increment).
+//    Curves are kept as traces (one row per screen column) so a band can be replayed cheaply and
+//    the previous curve can be erased without a full-screen clear.
+//
+//    A full redraw can instead go strip by strip: frameBeginStrip() takes one byte column over the
+//    full height (the same drawing calls clip to it) and frameFlushStrip() sends it with the
+//    cursor advancing downwards, one cursor setup per 240 bytes instead of one per row
+//    (frameFlushStripRows() sends part of it the same way).
+//
+//    Consecutive samples of a trace are joined by integer line segments (frameDrawSegment), so a
+//    steep curve stays connected at one sample per column. Samples above or below the window are
+//    kept as FRAME_ROW_ABOVE/FRAME_ROW_BELOW so the segment towards them is clipped at the edge
+//    instead of dropped. A trace may come with a breaks bitmap (see Sampler.h) naming the pairs of
+//    columns that must not be joined; without one, a segment that jumps across the window against
+//    the curve's direction is taken to be a discontinuity (an asymptote) and left out.
+//    Exact traces (frameDrawExactTraceColumns) hold ints instead: every sample keeps its row
+//    however far off the window it is, and only the breaks bitmap decides what is joined. A
+//    picture drawn from them is the same, row for row, whatever rows it is moved by, so a pan can
+//    draw the rows it scrolls in next to rows kept from before (see [Panning] in Graph.c).
+//
+//    Bands and strips are flushed to the layer at frameSetDrawAddress(). What the controller shows
+//    is set by frameSetScroll() (start addresses of screen blocks 1 and 2) and frameSetOverlay()
+//    (block 1 as the text layer or as a second graphics layer). Moving a start address by one
+//    byte scrolls the picture by 8 pixels and moving it by one row (FRAME_BYTES_PER_ROW) scrolls it
+//    by one line; with AP equal to the screen width the rows form one continuous ribbon, so the
+//    bytes that scroll in at an edge are exactly the ones that scrolled out at the other edge and
+//    can be rewritten in place, off screen in a page that is flipped to (see panGraph in Graph.c). frameSetSplitScroll() divides the
+//    screen: blocks 1 and 2 fill the top, blocks 3 (text) and 4 (graphics) the lines below.
+
+#define FRAME_WIDTH 320
+#define FRAME_HEIGHT 240
+#define FRAME_BYTES_PER_ROW 40     // 8 pixels per byte, bit 7 is the leftmost pixel
+#define FRAME_LAYER_ADDRESS 9600   // graphics layer = screen block 2 (see P_SCROLL_P4_MONO/P5_MONO)
+#define FRAME_LAYER_BYTES (FRAME_BYTES_PER_ROW * FRAME_HEIGHT)
+#define FRAME_DIRTY_BYTES_PER_ROW (FRAME_BYTES_PER_ROW / 8)   // one bit per byte column
+#define FRAME_TEXT_LAYER_BYTES 1200   // 40x30 text layer (one text page)
+#ifndef FRAME_TEXT_PAGES
+   #define FRAME_TEXT_PAGES 2         // text pages from address 0 up, below the graph layers (see Screens.h)
+#endif
+#define FRAME_VRAM_SIZE 32768         // display memory fitted to the board
+#ifndef FRAME_BAND_ROWS
+   #define FRAME_BAND_ROWS 8       // 320 bytes of pixels + 40 bytes of dirty bits
+#endif
+#define FRAME_NO_ROW 255           // trace entry for a column without a sample
+#define FRAME_ROW_ABOVE 254        // trace entry for a sample above the top edge
+#define FRAME_ROW_BELOW 253        // trace entry for a sample below the bottom edge
+#define FRAME_EXACT_NO_ROW (-32767)   // exact trace entry for a column without a sample
+#define FRAME_JUMP_ROWS (FRAME_HEIGHT / 2)   // a jump this large against the curve's direction is not joined
+#define FRAME_BREAK_BYTES (FRAME_WIDTH / 8)  // one bit per column: '1' = do not join it to the next column
+#define FRAME_RUN_MERGE_GAP 4      // clean bytes cheaper to resend than to restart the cursor (CSRW + 2 + MEMWRITE)
+
+void frameBeginBand(int firstRow);
+int frameGetBandFirstRow();
+void frameBeginStrip(int byteColumn);
+unsigned int frameFlushStrip();
+unsigned int frameFlushStripRows(int firstRow, int lastRow);
+void frameSetPixel(int x, int y);
+void frameMarkDirty(int x, int y);
+void frameSetDirtyRegion(const unsigned char *columnMask, int firstRow, int lastRow);
+void frameSetScroll(unsigned int block1Address, unsigned int block2Address);
+void frameSetSplitScroll(unsigned int block1Address, unsigned int block2Address, int upperLines,
+                         unsigned int block3Address, unsigned int block4Address);
+unsigned int frameGetScroll(int block);
+void frameSetOverlay(char block1Graphics);
+void frameSetDrawAddress(unsigned int address);
+unsigned int frameGetDrawAddress();
+void frameDrawSegment(int x0, int y0, int x1, int y1, char draw);
+char frameSegmentJoins(const unsigned char *rows, const unsigned char *breaks, int x);
+unsigned int frameFlushBand();
+void frameDrawTraceBand(const unsigned char *rows, const unsigned char *breaks, char draw);
+void frameDrawTraceColumns(const unsigned char *rows, const unsigned char *breaks, int origin, char draw,
+                           int firstX, int lastX);
+void frameDrawExactTraceColumns(const int *rows, const unsigned char *breaks, int origin, char draw, int firstX,
+                                int lastX);
+unsigned int frameDrawTrace(const unsigned char *newRows, const unsigned char *oldRows);
+
+#endif
@@ -0,0 +1,777 @@
+#include <stddef.h>
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+#include "Expression.h"
+#include "Sampler.h"
+#include "Axes.h"
+#include "Graph.h"
+
+// [Layers]
+//    The graph screen shows two graphics layers OR-ed by the controller (C_OVERLAY with screen
+//    block 1 in graphics mode): the axes and grid in block 1, the curves in block 2. The axes layer
+//    is only redrawn when the window or the tick spacing changes, so editing an equation and coming
+//    back rewrites the curve layer alone. graphHide() gives block 1 back to the text layer.
+//
+//    The curve layer is double-buffered: a full redraw goes into the page that is not on screen
+//    and becomes visible with a single C_SCROLL (showGraphPage), however long the sampling took.
+//    The space above the text pages (see Screens.h) is split into two zones of GRAPH_ZONE_BYTES,
+//    one per curve page: page 0 is drawn near the bottom of its zone, page 1 near the top of its
+//    own, GRAPH_HOME_ROOM bytes from the zone's edge and from the axes layer, which sits in the
+//    middle, across the two zones. The axes layer itself is
+//    single-buffered, it only changes with the window. Nothing else writes to these addresses, so
+//    the layers stay valid while a text screen is shown and coming back to an unchanged graph is a
+//    C_SCROLL (drawGraph).
+//
+//    A pan scrolls the picture, and a single-buffered axes layer cannot scroll without rewriting
+//    bytes on screen, so panning switches to composite mode: the axes are drawn into the curve
+//    pages as well and block 1 shows the same page as block 2. The axes layer is then free space
+//    and each page may move anywhere in its zone, GRAPH_PAN_ROOM bytes past its home (see
+//    [Panning]). The next redraw goes back to the layers once the page on screen is clear of the
+//    axes layer, which is at the latest one redraw later (the other page is drawn at its home).
+//
+//    Under a split screen (graphSetSplit) the window is mapped to the top GRAPH_SPLIT_ROWS rows
+//    and the controller's lower screen blocks show GRAPH_SPLIT_TEXT_ROWS text rows below it:
+//    block 3 (layer 1) the command line rows passed to graphShowText(), block 4 (layer 2) a blank
+//    strip at the top of display memory, so the curves' rows below the window stay hidden. The
+//    layers keep their full height, a vertical pan still finds the rows it scrolls in.
+   #define GRAPH_SPLIT_ROWS (FRAME_HEIGHT - (8 * GRAPH_SPLIT_TEXT_ROWS))   // 8-line characters
+   #define GRAPH_BLANK_BYTES ((FRAME_HEIGHT - GRAPH_SPLIT_ROWS) * FRAME_BYTES_PER_ROW)
+   #define GRAPH_BLANK_ADDRESS (FRAME_VRAM_SIZE - GRAPH_BLANK_BYTES)
+   #define GRAPH_LAYERS_START (FRAME_TEXT_PAGES * FRAME_TEXT_LAYER_BYTES)
+   #define GRAPH_ZONE_BYTES ((GRAPH_BLANK_ADDRESS - GRAPH_LAYERS_START) / 2)   // 14864 bytes
+   #define GRAPH_PAN_ROOM (GRAPH_ZONE_BYTES - FRAME_LAYER_BYTES)               // 5264 bytes: 131 rows
+   #define GRAPH_AXES_HOME (GRAPH_LAYERS_START + GRAPH_PAN_ROOM + (FRAME_LAYER_BYTES / 2))   // between the pages' homes
+   #define GRAPH_HOME_ROOM ((GRAPH_AXES_HOME - GRAPH_LAYERS_START - FRAME_LAYER_BYTES) / 2)   // 232 bytes
+
+#if (GRAPH_BLANK_ADDRESS - GRAPH_LAYERS_START) < (3 * FRAME_LAYER_BYTES)
+   #error "FRAME_TEXT_PAGES leaves no room for the graph layers"
+#endif
+
+// what a curve page holds (graphPageState)
+   #define GRAPH_PAGE_STALE '0'    // an older picture
+   #define GRAPH_PAGE_CURVES 'c'   // the curves of the view on screen, for the axes layer to go over
+   #define GRAPH_PAGE_WHOLE 'a'    // the curves and the axes of the view on screen (composite)
+
+// [Frame]
+//    Samples are taken in the frame of the window drawGraph() was last given: column c is at
+//    graphFrameXMin + c * graphXStep, rows are graphWindow's. A pan moves the view over the frame
+//    (graphViewStrip, graphViewRow) rather than moving the window, so a row or column that stays
+//    on screen has exactly the samples a redraw of the panned view takes, and the rows and
+//    columns that scroll in join it pixel for pixel. A view that would move more than
+//    GRAPH_FRAME_ROWS rows (where the sampler stops refining, SAMPLER_MARGIN_ROWS) or
+//    GRAPH_FRAME_COLUMNS columns from its frame is redrawn in a new frame instead.
+   #define GRAPH_FRAME_ROWS SAMPLER_MARGIN_ROWS
+   #define GRAPH_FRAME_COLUMNS 8000   // keeps the axes' positions in range (see Axes.c)
+
+// the columns of one equation's trace the sweep is drawing (see [Column Sweep])
+   #define GRAPH_TRACE_COLUMNS (SAMPLER_INITIAL_STEP + 2)   // a strip, the column before and the one after
+   #define GRAPH_TRACE_BREAK_BYTES 2
+   #define GRAPH_NO_STRIP -32767                           // graphSampledStrip when the traces hold nothing
+
+// rows a strip's curves reach (graphExtents): the first and last of 16 steps of GRAPH_EXTENT_ROWS
+// frame rows, from GRAPH_FRAME_ROWS above the window to as far below it, in the high and low
+// nibble. Rows beyond count as the first or last step.
+   #define GRAPH_EXTENT_ROWS ((FRAME_HEIGHT + (2 * GRAPH_FRAME_ROWS) + 15) / 16)   // 23 rows
+   #define GRAPH_EXTENT_EMPTY 0xF0                                               // no curve in the strip
+
+typedef struct {
+   int rows[GRAPH_TRACE_COLUMNS];                      // rows[0] is the column left of the strip
+   unsigned char breaks[GRAPH_TRACE_BREAK_BYTES];
+} GraphTrace;
+
+GraphTrace graphTraces[GRAPH_EQUATIONS];
+double graphPixels[GRAPH_EQUATIONS];   // unrounded row of each equation at the traces' last grid column
+int graphSampledStrip = GRAPH_NO_STRIP;   // frame strip the traces hold
+unsigned char graphExtents[FRAME_BYTES_PER_ROW];   // by frame strip, modulo the strips on screen
+double graphBounds[4];                 // window on screen
+double graphScales[2];                 // tick spacing of the axes
+char graphBoundsSet = '0';             // '1' once graphBounds and the frame hold a window
+PlotWindow graphWindow;                // the frame's window (see [Frame])
+double graphFrameXMin;
+double graphXStep;
+int graphViewStrip;                    // frame byte column of the screen's left edge
+int graphViewRow;                      // frame row of the screen's top edge
+char graphOnScreen = '0';              // '1' while the curve page on screen shows the equations over graphBounds
+char graphAxesOnScreen = '0';          // '1' while the axes shown (layer or composite pages) match the window
+char graphLayersShown = '0';           // '1' while the controller shows the two graph layers
+int graphPage;                         // curve page on screen (0 or 1); redraws go to the other one
+unsigned int graphPageAddress[2];      // where each curve page starts (the screen's top left byte)
+char graphPageState[2] = {GRAPH_PAGE_STALE, GRAPH_PAGE_STALE};
+char graphComposite = '0';             // '1' while block 1 shows the curve page instead of the axes layer
+int graphIdleStrip = -1;               // next strip graphIdle() draws, -1 while it is not under way
+int graphRows = FRAME_HEIGHT;          // rows the window is mapped to (GRAPH_SPLIT_ROWS under a split screen)
+unsigned int graphTextAddress;         // command line rows shown under a split screen
+char graphBlankCleared = '0';          // '1' once the blank strip for screen block 4 is cleared
+unsigned long graphEvaluations;        // equation evaluations since start-up (for measurement)
+
+// an equation changed: the next drawGraph() samples and draws every curve again
+void graphInvalidateAll()
+{
+   graphOnScreen = '0';
+   graphSampledStrip = GRAPH_NO_STRIP;
+   graphIdleStrip = -1;
+}
+
+unsigned long graphGetEvaluations()
+{
+   return graphEvaluations;
+}
+
+// moves the screen over the frame; samples taken for another row no longer fit the traces
+static void setView(int strip, int row)
+{
+   if (row != graphViewRow) {
+      graphSampledStrip = GRAPH_NO_STRIP;
+   }
+   graphViewStrip = strip;
+   graphViewRow = row;
+   axesSetView(strip * 8, row);
+}
+
+// -1 (nothing changed) if the bounds do not make a window (see plotWindowInit); otherwise the
+// window starts a new frame
+static int setGraphWindow(const double *windowBounds)
+{
+   int i;
+   if (plotWindowInit(&graphWindow, windowBounds[WINDOW_X_MIN], windowBounds[WINDOW_X_MAX],
+                      windowBounds[WINDOW_Y_MIN], windowBounds[WINDOW_Y_MAX], FRAME_WIDTH, graphRows) != 0) {
+      return -1;
+   }
+   for (i = 0; i < 4; i++) {
+      graphBounds[i] = windowBounds[i];
+   }
+   graphScales[0] = windowBounds[WINDOW_X_SCALE];
+   graphScales[1] = windowBounds[WINDOW_Y_SCALE];
+   graphFrameXMin = graphBounds[WINDOW_X_MIN];
+   graphXStep = ((graphBounds[WINDOW_X_MAX] - graphBounds[WINDOW_X_MIN]) / FRAME_WIDTH);
+   HAL_CYCLES(CYCLES_FLOAT_ADD + CYCLES_FLOAT_DIV);
+   axesSetWindow(graphBounds[WINDOW_X_MIN], graphBounds[WINDOW_X_MAX], graphBounds[WINDOW_Y_MIN],
+                 graphBounds[WINDOW_Y_MAX], graphScales[0], graphScales[1], graphRows);
+   graphSampledStrip = GRAPH_NO_STRIP;
+   graphIdleStrip = -1;
+   setView(0, 0);
+   graphBoundsSet = '1';
+   return 0;
+}
+
+// '1' if windowBounds (including the tick spacing) is the window currently set
+static char sameWindow(const double *windowBounds)
+{
+   int i;
+   if (graphBoundsSet == '0') {
+      return '0';
+   }
+   for (i = 0; i < 4; i++) {
+      if (graphBounds[i] != windowBounds[i]) {
+         return '0';
+      }
+   }
+   if ((graphScales[0] != windowBounds[WINDOW_X_SCALE]) || (graphScales[1] != windowBounds[WINDOW_Y_SCALE])) {
+      return '0';
+   }
+   return '1';
+}
+
+// takes the new window if it differs from the current one: new bounds redraw the curves, any
+// change (bounds or tick spacing) the axes layer. -1 if the bounds make no window.
+static int updateGraphWindow(const double *windowBounds)
+{
+   int i;
+   char boundsChanged = ((graphBoundsSet == '1') ? '0' : '1');
+   if (sameWindow(windowBounds) == '1') {
+      return 0;
+   }
+   for (i = 0; i < 4; i++) {
+      if (graphBounds[i] != windowBounds[i]) {
+         boundsChanged = '1';
+      }
+   }
+   if (setGraphWindow(windowBounds) != 0) {
+      return -1;
+   }
+   graphAxesOnScreen = '0';
+   if (boundsChanged == '1') {
+      graphInvalidateAll();
+   }
+   return 0;
+}
+
+static unsigned int zoneStart(int page)
+{
+   return (unsigned int) (GRAPH_LAYERS_START + (page * GRAPH_ZONE_BYTES));
+}
+
+// where a layered redraw draws the page: clear of the axes layer and of the other page, with
+// GRAPH_HOME_ROOM bytes to pan either way (232 byte columns or 5 rows)
+static unsigned int pageHome(int page)
+{
+   if (page == 0) {
+      return (zoneStart(0) + GRAPH_HOME_ROOM);
+   }
+   return (zoneStart(1) + GRAPH_PAN_ROOM - GRAPH_HOME_ROOM);
+}
+
+// '1' if the page fits in its zone starting at address
+static char inZone(int page, long address)
+{
+   long start = zoneStart(page);
+   return (((address >= start) && ((address + FRAME_LAYER_BYTES) <= (start + GRAPH_ZONE_BYTES))) ? '1' : '0');
+}
+
+// where a page drawn whole goes: its home while the axes layer is on screen, else the middle of
+// its zone, with room to pan both ways
+static unsigned int wholePageAddress(int page)
+{
+   if (graphComposite == '0') {
+      return pageHome(page);
+   }
+   return (zoneStart(page) + (GRAPH_PAN_ROOM / 2));
+}
+
+// the layer screen block 1 shows over the curves
+static unsigned int block1Address()
+{
+   return ((graphComposite == '1') ? graphPageAddress[graphPage] : GRAPH_AXES_HOME);
+}
+
+// makes the axes layer and the current curve page visible; returns the bus bytes it took
+static unsigned int showGraphPage()
+{
+   unsigned int busBytes = 6;
+   if (graphLayersShown == '0') {
+      frameSetOverlay('1');
+      graphLayersShown = '1';
+      busBytes += 2;
+   }
+   if (graphRows != FRAME_HEIGHT) {
+      frameSetSplitScroll(block1Address(), graphPageAddress[graphPage], graphRows, graphTextAddress,
+                          GRAPH_BLANK_ADDRESS);
+      return (busBytes + 5);
+   }
+   frameSetScroll(block1Address(), graphPageAddress[graphPage]);
+   return busBytes;
+}
+
+// '1' puts GRAPH_SPLIT_TEXT_ROWS rows of text under a shorter graph, '0' gives the graph the full
+// height again. The window maps to different rows, so the next drawGraph() samples every slot.
+void graphSetSplit(char split)
+{
+   int rows = ((split == '1') ? GRAPH_SPLIT_ROWS : FRAME_HEIGHT);
+   if (rows == graphRows) {
+      return;
+   }
+   if ((split == '1') && (graphBlankCleared == '0')) {
+      busProfileBegin(BUS_OP_GRAPH);
+      beginDirectMode();
+      fillDisplayMemory(GRAPH_BLANK_ADDRESS, 0b00000000, GRAPH_BLANK_BYTES);
+      endDirectMode();
+      busProfileEnd();
+      graphBlankCleared = '1';
+   }
+   graphRows = rows;
+   graphBoundsSet = '0';
+   graphIdleStrip = -1;
+}
+
+// shows the text from textAddress (GRAPH_SPLIT_TEXT_ROWS rows of a text page) under a split graph;
+// moving it by a text row scrolls the command line. Sends nothing if it is already shown.
+void graphShowText(unsigned int textAddress)
+{
+   if (textAddress == graphTextAddress) {
+      return;
+   }
+   graphTextAddress = textAddress;
+   if ((graphLayersShown == '1') && (graphRows != FRAME_HEIGHT)) {
+      BUS_PROFILED(BUS_OP_SCREEN_SWITCH,
+                   frameSetSplitScroll(block1Address(), graphPageAddress[graphPage], graphRows, graphTextAddress,
+                                       GRAPH_BLANK_ADDRESS));
+   }
+}
+
+// gives screen block 1 back to the text page at textAddress; the graph layers stay in display
+// memory. Returns '0' (and sends nothing) if the graph was not shown.
+char graphHide(unsigned int textAddress)
+{
+   if (graphLayersShown == '0') {
+      return '0';
+   }
+   frameSetOverlay('0');
+   frameSetScroll(textAddress, graphPageAddress[graphPage]);
+   graphLayersShown = '0';
+   return '1';
+}
+
+// [Column Sweep]
+//    The curves go left to right one strip (8 columns, one byte column) at a time. Every equation
+//    is first sampled up to the strip's right edge (the x of each 8-column step is computed once
+//    for all of them, the sampler's refinement fills in between), then every trace draws its
+//    columns of the strip and the strip is sent top to bottom in one piece. A trace only lives in
+//    graphTraces for the strip it is drawn in (its columns, the one to the left and the one to
+//    the right, GRAPH_TRACE_COLUMNS rows), so the samples of all six equations take 132 bytes of
+//    SRAM rather than 4 KB. The picture itself is what is kept: an unchanged graph is shown again
+//    from its page (see [Layers]) and an edit samples every equation again. What is kept of each
+//    strip is graphExtents, the rows its curves reach, so that a vertical pan samples only the
+//    strips that draw into the rows it scrolls in.
+//    A strip is always sampled from the grid column one strip before it: sampleStrip() goes on
+//    from the strip sampled last when it is the one to the left, and starts a strip early
+//    otherwise. Either way the samples are the ones a sweep of the whole frame would take.
+
+static double columnX(int col)
+{
+   HAL_CYCLES(CYCLES_INT_TO_FLOAT + CYCLES_FLOAT_MUL + CYCLES_FLOAT_ADD);
+   return (graphFrameXMin + (col * graphXStep));
+}
+
+// moves a trace on to the next strip: the last two columns become the first two
+static void nextStrip(GraphTrace *trace)
+{
+   trace->rows[0] = trace->rows[SAMPLER_INITIAL_STEP];
+   trace->rows[1] = trace->rows[SAMPLER_INITIAL_STEP + 1];
+   trace->breaks[0] = trace->breaks[1];
+   trace->breaks[1] = 0b00000000;
+   HAL_CYCLES(10);
+}
+
+// graphExtents index of a frame strip
+static int extentIndex(int strip)
+{
+   HAL_CYCLES(40);   // 16-bit modulo by a constant
+   return (((strip % FRAME_BYTES_PER_ROW) + FRAME_BYTES_PER_ROW) % FRAME_BYTES_PER_ROW);
+}
+
+// graphExtents step holding frame row row
+static int extentStep(int row)
+{
+   row += GRAPH_FRAME_ROWS;
+   if (row < 0) {
+      return 0;
+   }
+   row /= GRAPH_EXTENT_ROWS;
+   return ((row > 15) ? 15 : row);
+}
+
+// notes the rows the traces reach in frame strip strip
+static void recordExtent(const CompiledExpression *equations, int strip)
+{
+   int top = 32767;
+   int bottom = -32767;
+   int slot;
+   int i;
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      if (equations[slot].valid != '1') {
+         continue;
+      }
+      for (i = 0; i < GRAPH_TRACE_COLUMNS; i++) {
+         int row = graphTraces[slot].rows[i];
+         if (row == FRAME_EXACT_NO_ROW) {
+            continue;
+         }
+         top = ((row < top) ? row : top);
+         bottom = ((row > bottom) ? row : bottom);
+      }
+      HAL_CYCLES(GRAPH_TRACE_COLUMNS * 10);
+   }
+   graphExtents[extentIndex(strip)] = ((top > bottom) ? GRAPH_EXTENT_EMPTY
+                                       : ((extentStep(top + graphViewRow) << 4) | extentStep(bottom + graphViewRow)));
+}
+
+// '1' if the curves of frame strip strip may reach screen rows firstRow..lastRow
+static char extentMeets(int strip, int firstRow, int lastRow)
+{
+   unsigned char extent = graphExtents[extentIndex(strip)];
+   int top = (extent >> 4);
+   int bottom = (extent & 0b00001111);
+   return (((top <= bottom) && (top <= extentStep(lastRow + graphViewRow))
+            && (bottom >= extentStep(firstRow + graphViewRow))) ? '1' : '0');
+}
+
+// fills graphTraces with the columns of frame strip strip, the one before and the one after
+static void sampleStrip(const CompiledExpression *equations, int strip)
+{
+   unsigned long evaluations = samplerGetEvaluations();
+   int firstX = (strip * 8);
+   double x;
+   int slot;
+   samplerSetWindow(&graphWindow, graphFrameXMin, graphXStep, graphViewRow);
+   if (graphSampledStrip != (strip - 1)) {
+      // sample the strip before, for the column left of this one
+      x = columnX(firstX - 8);
+      for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+         if (equations[slot].valid == '1') {
+            graphPixels[slot] = sampleTraceStart(&equations[slot], graphTraces[slot].rows, graphTraces[slot].breaks,
+                                                 firstX - 9, firstX - 8, x);
+         }
+      }
+      x = columnX(firstX);
+      for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+         if (equations[slot].valid == '1') {
+            graphPixels[slot] = sampleTraceTo(&equations[slot], graphTraces[slot].rows, graphTraces[slot].breaks,
+                                              firstX - 9, firstX - 8, graphPixels[slot], firstX, x);
+         }
+      }
+   }
+   x = columnX(firstX + 8);
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      if (equations[slot].valid == '1') {
+         nextStrip(&graphTraces[slot]);
+         graphPixels[slot] = sampleTraceTo(&equations[slot], graphTraces[slot].rows, graphTraces[slot].breaks,
+                                           firstX - 1, firstX, graphPixels[slot], firstX + 8, x);
+      }
+   }
+   graphSampledStrip = strip;
+   recordExtent(equations, strip);
+   graphEvaluations += (samplerGetEvaluations() - evaluations);
+}
+
+// clears screen strip strip and draws the axes over rows firstRow..lastRow (if withAxes is '1')
+// and the curves (if withCurves is '1', sampling the strip) into it
+static void renderStrip(const CompiledExpression *equations, int strip, char withAxes, char withCurves, int firstRow,
+                        int lastRow)
+{
+   int firstX = (strip * 8);
+   int slot;
+   frameBeginStrip(strip);
+   if (withAxes == '1') {
+      axesDrawRegion(firstX, firstX + 7, firstRow, lastRow);
+   }
+   if (withCurves == '0') {
+      return;
+   }
+   sampleStrip(equations, graphViewStrip + strip);
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      if (equations[slot].valid == '1') {
+         frameDrawExactTraceColumns(graphTraces[slot].rows, graphTraces[slot].breaks, firstX - 1, '1', firstX,
+                                    firstX + 7);
+      }
+   }
+}
+
+// sends rows firstRow..lastRow of the strip to the page at address; returns the bus bytes
+static unsigned int sendStrip(unsigned int address, int firstRow, int lastRow)
+{
+   frameSetDrawAddress(address);
+   return frameFlushStripRows(firstRow, lastRow);
+}
+
+// strips go down the layer: the cursor advances a row per byte (2 bus bytes, with endStrips)
+static void beginStrips()
+{
+   beginDirectMode();
+   setCursorDirectionDown();
+}
+
+static void endStrips()
+{
+   setCursorDirection();
+   endDirectMode();
+}
+
+// samples every equation and draws the whole view into the page at address, with the axes under
+// the curves if withAxes is '1' (see [Layers]); returns the bus bytes it took
+static unsigned int sweepGraph(const CompiledExpression *equations, char withAxes, unsigned int address)
+{
+   unsigned int busBytes = 0;
+   int strip;
+   for (strip = 0; strip < FRAME_BYTES_PER_ROW; strip++) {
+      renderStrip(equations, strip, withAxes, '1', 0, FRAME_HEIGHT - 1);
+      busBytes += sendStrip(address, 0, FRAME_HEIGHT - 1);
+   }
+   return busBytes;
+}
+
+// redraws the whole axes layer, strip by strip like the curves; returns the bus bytes it took
+static unsigned int sweepAxes()
+{
+   unsigned int busBytes = 0;
+   int strip;
+   for (strip = 0; strip < FRAME_BYTES_PER_ROW; strip++) {
+      renderStrip(NULL, strip, '1', '0', 0, FRAME_HEIGHT - 1);
+      busBytes += sendStrip(GRAPH_AXES_HOME, 0, FRAME_HEIGHT - 1);
+   }
+   graphAxesOnScreen = '1';
+   return busBytes;
+}
+
+// redraws the axes layer if it is stale and the curve layer into the hidden page at its home,
+// then flips. In composite mode with the page on screen over the axes layer, the hidden page is
+// drawn with the axes and the screen stays composite (see [Layers]).
+static unsigned int redrawGraph(const CompiledExpression *equations)
+{
+   unsigned int busBytes = 2;
+   int hidden = (1 - graphPage);
+   unsigned int shown = graphPageAddress[graphPage];
+   char withAxes = '0';
+   graphIdleStrip = -1;
+   beginStrips();
+   if ((graphComposite == '1') && ((shown + FRAME_LAYER_BYTES) > GRAPH_AXES_HOME)
+       && (shown < (GRAPH_AXES_HOME + FRAME_LAYER_BYTES))) {
+      graphAxesOnScreen = '1';
+      withAxes = '1';
+   } else {
+      if ((graphAxesOnScreen == '0') || (graphComposite == '1')) {
+         busBytes += sweepAxes();   // pans drew over it
+      }
+      graphComposite = '0';
+   }
+   graphPageAddress[hidden] = pageHome(hidden);
+   busBytes += sweepGraph(equations, withAxes, graphPageAddress[hidden]);
+   endStrips();
+   graphPageState[hidden] = ((withAxes == '1') ? GRAPH_PAGE_WHOLE : GRAPH_PAGE_CURVES);
+   graphPageState[graphPage] = GRAPH_PAGE_STALE;
+   graphPage = hidden;
+   graphOnScreen = '1';
+   return (busBytes + showGraphPage());
+}
+
+// draws the curves into the hidden page and flips to it (redrawing the axes layer first if the
+// window changed); returns the number of bus bytes it took. If nothing changed since the layers
+// were last drawn they are only shown again, with no evaluations.
+unsigned int drawGraph(const CompiledExpression *equations, const double *windowBounds)
+{
+   unsigned int busBytes;
+   busProfileBegin(BUS_OP_GRAPH);
+   if (updateGraphWindow(windowBounds) != 0) {
+      busBytes = 0;   // no window to draw: the screen stays as it is
+   } else if ((graphOnScreen == '1') && (graphAxesOnScreen == '1')) {
+      busBytes = showGraphPage();
+   } else {
+      busBytes = redrawGraph(equations);
+   }
+   busProfileEnd();
+   return busBytes;
+}
+
+// [Idle Catch-Up]
+//    After a redraw only the page on screen holds the picture, and without the axes if it went to
+//    the layers. Before the first pan can send just what scrolls in, both pages need the picture
+//    with the axes: graphIdle(), called by the main loop while no key is waiting, draws it strip
+//    by strip into the hidden page and, if it lacks them, into the page on screen as well. There
+//    the axes layer over it already shows the same axes, so nothing on screen changes. One strip
+//    per call keeps a key pressed meanwhile from waiting for a whole sweep; a pan, redraw or edit
+//    in between starts it over.
+
+// does one strip of the catch-up; returns '1' while there is more to do
+char graphIdle(const CompiledExpression *equations)
+{
+   int hidden = (1 - graphPage);
+   if ((graphBoundsSet == '0') || (graphOnScreen == '0') || (graphAxesOnScreen == '0') || (graphLayersShown == '0')
+       || ((graphPageState[graphPage] == GRAPH_PAGE_WHOLE) && (graphPageState[hidden] == GRAPH_PAGE_WHOLE))) {
+      return '0';
+   }
+   busProfileBegin(BUS_OP_GRAPH);
+   if (graphIdleStrip < 0) {
+      graphIdleStrip = 0;
+      graphPageAddress[hidden] = wholePageAddress(hidden);
+   }
+   beginStrips();
+   renderStrip(equations, graphIdleStrip, '1', '1', 0, FRAME_HEIGHT - 1);
+   sendStrip(graphPageAddress[hidden], 0, FRAME_HEIGHT - 1);
+   if (graphPageState[graphPage] != GRAPH_PAGE_WHOLE) {
+      sendStrip(graphPageAddress[graphPage], 0, FRAME_HEIGHT - 1);
+   }
+   endStrips();
+   busProfileEnd();
+   graphIdleStrip++;
+   if (graphIdleStrip < FRAME_BYTES_PER_ROW) {
+      return '1';
+   }
+   graphPageState[0] = GRAPH_PAGE_WHOLE;
+   graphPageState[1] = GRAPH_PAGE_WHOLE;
+   graphIdleStrip = -1;
+   return '0';
+}
+
+// [Panning]
+//    The picture is moved by the graphics blocks' start address and only what scrolled in is
+//    sampled and sent. Nothing on screen is written: both curve pages hold the picture with the
+//    axes (composite mode, see [Layers] and [Idle Catch-Up]) and what scrolls in is drawn once
+//    and sent to both.
+//    For a vertical pan the rows that scroll in are off screen in both pages, so each page that
+//    stays in its zone gets them in place and the C_SCROLL moves to the page on screen. Only the
+//    strips whose curves reach those rows (graphExtents) are sampled; the others get just the
+//    axes. A horizontal pan goes a byte column at a time, each with its flip, as the new column
+//    of a page lies on screen in the row below: the new strip is sampled (going on from the
+//    sweep's last strip when panning right), sent to the hidden page, flipped to, and sent to the
+//    page now off screen.
+//    A page that would leave its zone, or did not hold the picture, is drawn whole instead, in the
+//    middle of its zone (from there it pans GRAPH_PAN_ROOM / 2 bytes, 65 rows or 2632 byte
+//    columns, either way); the page that went off screen without what scrolled in is left to
+//    graphIdle(). A pan of half a screen or more is a redraw, both pages would take more bytes
+//    than a page drawn whole, and so is one that leaves the frame (see [Frame]).
+   #define GRAPH_PAN_COLUMN_BYTES (FRAME_BYTES_PER_ROW / 2)
+   #define GRAPH_PAN_ROWS (FRAME_HEIGHT / 2)
+
+// moves the window by whole screen pixels so the picture on screen stays exact
+static void shiftWindowBounds(double *windowBounds, int columns, int rows)
+{
+   double xPerColumn = ((windowBounds[WINDOW_X_MAX] - windowBounds[WINDOW_X_MIN]) / FRAME_WIDTH);
+   double yPerRow = ((windowBounds[WINDOW_Y_MAX] - windowBounds[WINDOW_Y_MIN]) / graphRows);
+   windowBounds[WINDOW_X_MIN] += (columns * xPerColumn);
+   windowBounds[WINDOW_X_MAX] += (columns * xPerColumn);
+   windowBounds[WINDOW_Y_MIN] -= (rows * yPerRow);
+   windowBounds[WINDOW_Y_MAX] -= (rows * yPerRow);
+}
+
+// '1' if the page holds the picture with the axes and still fits in its zone moved by delta
+// bytes. A page on screen that does leaves the axes layer to the pages: block 1 shows the page
+// itself, which changes nothing on screen.
+static char pageMoves(int page, long delta, unsigned int *busBytes)
+{
+   if (graphPageState[page] != GRAPH_PAGE_WHOLE) {
+      return '0';
+   }
+   if ((page == graphPage) && (graphComposite == '0')) {
+      graphComposite = '1';
+      *busBytes += showGraphPage();
+   }
+   return inZone(page, graphPageAddress[page] + delta);
+}
+
+// draws the whole hidden page with the axes where it has room to pan; returns the bus bytes
+static unsigned int sweepHidden(const CompiledExpression *equations)
+{
+   int hidden = (1 - graphPage);
+   graphPageAddress[hidden] = wholePageAddress(hidden);
+   return sweepGraph(equations, '1', graphPageAddress[hidden]);
+}
+
+// shows the hidden page, which holds the panned picture, over both blocks; the page that went
+// off screen is stale. Returns the bus bytes it took.
+static unsigned int flipPanned()
+{
+   graphPageState[graphPage] = GRAPH_PAGE_STALE;
+   graphPage = (1 - graphPage);
+   graphPageState[graphPage] = GRAPH_PAGE_WHOLE;
+   graphComposite = '1';
+   return showGraphPage();
+}
+
+// moves the view rows pixels down (0 < |rows| < GRAPH_PAN_ROWS); returns the bus bytes it took
+static unsigned int panRows(const CompiledExpression *equations, int rows)
+{
+   long delta = ((long) rows * FRAME_BYTES_PER_ROW);
+   int firstNew = ((rows > 0) ? (FRAME_HEIGHT - rows) : 0);
+   int lastNew = ((rows > 0) ? (FRAME_HEIGHT - 1) : (-rows - 1));
+   int hidden = (1 - graphPage);
+   unsigned int busBytes = 2;
+   char shownMoves = pageMoves(graphPage, delta, &busBytes);
+   char hiddenMoves = pageMoves(hidden, delta, &busBytes);
+   int strip;
+   setView(graphViewStrip, graphViewRow + rows);
+   beginStrips();
+   if ((shownMoves == '0') && (hiddenMoves == '0')) {
+      busBytes += sweepHidden(equations);
+      endStrips();
+      return (busBytes + flipPanned());
+   }
+   if (hiddenMoves == '1') {
+      graphPageAddress[hidden] = (unsigned int) (graphPageAddress[hidden] + delta);
+   }
+   for (strip = 0; strip < FRAME_BYTES_PER_ROW; strip++) {
+      renderStrip(equations, strip, '1', extentMeets(graphViewStrip + strip, firstNew, lastNew), firstNew, lastNew);
+      if (hiddenMoves == '1') {
+         busBytes += sendStrip(graphPageAddress[hidden], firstNew, lastNew);
+      }
+      if (shownMoves == '1') {
+         busBytes += sendStrip((unsigned int) (graphPageAddress[graphPage] + delta), firstNew, lastNew);
+      }
+   }
+   endStrips();
+   if (shownMoves == '0') {
+      return (busBytes + flipPanned());
+   }
+   graphPageAddress[graphPage] = (unsigned int) (graphPageAddress[graphPage] + delta);
+   if (hiddenMoves == '0') {
+      graphPageState[hidden] = GRAPH_PAGE_STALE;
+   }
+   return (busBytes + showGraphPage());
+}
+
+// moves the view one byte column (step 1 or -1) to the right; returns the bus bytes it took
+static unsigned int panColumn(const CompiledExpression *equations, int step)
+{
+   int newStrip = ((step > 0) ? (FRAME_BYTES_PER_ROW - 1) : 0);
+   int hidden = (1 - graphPage);
+   unsigned int busBytes = 2;
+   char shownMoves = pageMoves(graphPage, step, &busBytes);
+   char hiddenMoves = pageMoves(hidden, step, &busBytes);
+   setView(graphViewStrip + step, graphViewRow);
+   beginStrips();
+   if (hiddenMoves == '1') {
+      graphPageAddress[hidden] = (unsigned int) (graphPageAddress[hidden] + step);
+      renderStrip(equations, newStrip, '1', '1', 0, FRAME_HEIGHT - 1);
+      busBytes += sendStrip(graphPageAddress[hidden], 0, FRAME_HEIGHT - 1);
+   } else {
+      busBytes += sweepHidden(equations);
+      if ((shownMoves == '1') && (newStrip != (FRAME_BYTES_PER_ROW - 1))) {
+         renderStrip(equations, newStrip, '1', '1', 0, FRAME_HEIGHT - 1);   // the sweep ended on the last strip
+      }
+   }
+   int previous = graphPage;
+   busBytes += flipPanned();
+   if (shownMoves == '1') {
+      graphPageAddress[previous] = (unsigned int) (graphPageAddress[previous] + step);
+      graphPageState[previous] = GRAPH_PAGE_WHOLE;
+      busBytes += sendStrip(graphPageAddress[previous], 0, FRAME_HEIGHT - 1);
+   }
+   endStrips();
+   return busBytes;
+}
+
+// moves the view 8 * columnBytes pixels to the right and rows pixels down, updating
+// windowBounds; returns the number of bus bytes it took
+static unsigned int shiftGraph(const CompiledExpression *equations, double *windowBounds, int columnBytes, int rows)
+{
+   int i;
+   if ((columnBytes != 0) && (rows != 0)) {
+      unsigned int busBytes = shiftGraph(equations, windowBounds, columnBytes, 0);
+      return (busBytes + shiftGraph(equations, windowBounds, 0, rows));
+   }
+   char unchanged = sameWindow(windowBounds);
+   double previousBounds[4];
+   PlotWindow shifted;
+   for (i = 0; i < 4; i++) {
+      previousBounds[i] = windowBounds[i];
+   }
+   shiftWindowBounds(windowBounds, columnBytes * 8, rows);
+   if (plotWindowInit(&shifted, windowBounds[WINDOW_X_MIN], windowBounds[WINDOW_X_MAX], windowBounds[WINDOW_Y_MIN],
+                      windowBounds[WINDOW_Y_MAX], FRAME_WIDTH, graphRows) != 0) {
+      for (i = 0; i < 4; i++) {
+         windowBounds[i] = previousBounds[i];   // panned out of range: stay where we are
+      }
+      return 0;
+   }
+   int viewColumn = ((graphViewStrip + columnBytes) * 8);
+   int viewRow = (graphViewRow + rows);
+   if ((graphOnScreen == '0') || (graphAxesOnScreen == '0') || (graphLayersShown == '0') || (unchanged == '0')
+       || (columnBytes >= GRAPH_PAN_COLUMN_BYTES) || (columnBytes <= -GRAPH_PAN_COLUMN_BYTES)
+       || (rows >= GRAPH_PAN_ROWS) || (rows <= -GRAPH_PAN_ROWS)
+       || (viewColumn > GRAPH_FRAME_COLUMNS) || (viewColumn < -GRAPH_FRAME_COLUMNS)
+       || (viewRow > GRAPH_FRAME_ROWS) || (viewRow < -GRAPH_FRAME_ROWS)) {
+      return drawGraph(equations, windowBounds);   // new bounds: a new frame
+   }
+   for (i = 0; i < 4; i++) {
+      graphBounds[i] = windowBounds[i];   // the frame stays
+   }
+   graphIdleStrip = -1;
+   if (rows != 0) {
+      return panRows(equations, rows);
+   }
+   unsigned int busBytes = 0;
+   int step = ((columnBytes > 0) ? 1 : -1);
+   for (i = 0; i != columnBytes; i += step) {
+      busBytes += panColumn(equations, step);
+   }
+   return busBytes;
+}
+
+// shiftGraph() with its bytes charged to the graph in the bus profile
+unsigned int panGraph(const CompiledExpression *equations, double *windowBounds, int columnBytes, int rows)
+{
+   busProfileBegin(BUS_OP_GRAPH);
+   unsigned int busBytes = shiftGraph(equations, windowBounds, columnBytes, rows);
+   busProfileEnd();
+   return busBytes;
+}
@@ -0,0 +1,48 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+// [Graph Screen]
+//    drawGraph() plots up to GRAPH_EQUATIONS compiled equations over the window in windowBounds.
+//    No samples are kept in SRAM; the pictures in display memory are the cache. Coming back to
+//    the graph screen from a menu with nothing changed only shows the layers again (one C_SCROLL,
+//    no evaluations). After graphInvalidateAll() (an equation now compiles to different code) or
+//    with new window bounds, every equation is sampled and drawn again into the hidden page. There
+//    is no per-equation redraw: erasing one curve means redrawing the strips it crossed, and the
+//    other curves in them, from samples SRAM does not keep.
+//    The axes and grid sit in a layer of their own, redrawn only when the window changes (see
+//    [Layers] in Graph.c); graphHide() hands the display back to a text page when leaving.
+//    panGraph() moves the view by scrolling the picture in hardware and only evaluates and sends
+//    what scrolls in, once for both pages (see [Panning] in Graph.c). Nothing on screen is
+//    written. Both pages need the picture with the axes first: graphIdle(), called while no key
+//    is waiting, draws it strip by strip after a redraw (see [Idle Catch-Up] in Graph.c).
+//    Pan limits: a pan of half a screen (20 byte columns or 120 rows) or more is a redraw, and so
+//    is one that takes the view more than 64 rows or 8000 columns from the window last drawn; a
+//    page moves 65 rows (2632 bytes, GRAPH_PAN_ROOM / 2) either way from the middle of its zone
+//    before it is drawn whole.
+//    Bounds plotWindowInit() rejects (empty, reversed or out of the Q16.16 range) draw nothing:
+//    drawGraph() returns 0 and leaves the screen alone, and panGraph() leaves windowBounds as it was.
+//    graphSetSplit() shortens the graph to leave a few text rows under it for the command line
+//    (graphShowText), so calculating never hides or redraws the graph.
+//    Include Expression.h before this header.
+
+#define GRAPH_EQUATIONS 6          // equation slots (equA..equF)
+#define GRAPH_SPLIT_TEXT_ROWS 2    // text rows under the graph in split-screen mode
+
+// windowBounds entries (WINDOW_BOUNDS_SIZE doubles)
+   #define WINDOW_X_MIN 0
+   #define WINDOW_X_MAX 1
+   #define WINDOW_Y_MIN 2
+   #define WINDOW_Y_MAX 3
+   #define WINDOW_X_SCALE 4        // axis tick spacing
+   #define WINDOW_Y_SCALE 5
+
+void graphInvalidateAll();
+unsigned int drawGraph(const CompiledExpression *equations, const double *windowBounds);
+char graphIdle(const CompiledExpression *equations);
+char graphHide(unsigned int textAddress);
+void graphSetSplit(char split);
+void graphShowText(unsigned int textAddress);
+unsigned int panGraph(const CompiledExpression *equations, double *windowBounds, int columnBytes, int rows);
+unsigned long graphGetEvaluations();
+
+#endif
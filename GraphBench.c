@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <string.h>
+#define HOST_PROGRAM
+#include "DisplayHAL.h"
+#include "SED1335Sim.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+#include "Expression.h"
+#include "Sampler.h"
+#include "Graph.h"
+
+// [Graph Sweep Benchmark]
+//    Draws 1 to 6 equations from scratch on the host model two ways: one equation at a time
+//    (each trace sampled over the whole width, then the layer rendered band by band, every band
+//    walking every trace) as drawGraph did before the column sweep, and with drawGraph's fused
+//    sweep. Each is followed by coming back to the graph with nothing changed: the old path redrew
+//    from its full-width traces, drawGraph only shows its layers again. The two pictures are compared
+//    byte for byte, so the columns differ only in cost.
+
+#define BENCH_X_MIN -10.0
+#define BENCH_X_MAX 10.0
+#define BENCH_Y_MIN -10.0
+#define BENCH_Y_MAX 10.0
+
+static const char *benchEquations[GRAPH_EQUATIONS] = {
+   "x^2/4-3",
+   "3sin(x)",
+   "tan(x)",
+   "x^3/20-x",
+   "1/x",
+   "e^(-x^2/8)*6"
+};
+
+// firmware entry point (DisplayDemoGraphicsOnly.c), brings up the display
+int firmwareMain(void);
+
+static CompiledExpression benchCompiled[GRAPH_EQUATIONS];
+// drawGraph samples from a strip left of the window to the column after it (see [Column Sweep])
+#define BENCH_FIRST_COLUMN (-SAMPLER_INITIAL_STEP)
+#define BENCH_COLUMNS (FRAME_WIDTH + SAMPLER_INITIAL_STEP + 1)
+
+static int benchRows[GRAPH_EQUATIONS][BENCH_COLUMNS];
+static unsigned char benchBreaks[GRAPH_EQUATIONS][(BENCH_COLUMNS + 7) / 8];
+static unsigned char benchPicture[FRAME_LAYER_BYTES];
+
+static unsigned int renderBands(int equations)
+{
+   unsigned char allColumns[FRAME_DIRTY_BYTES_PER_ROW];
+   unsigned int busBytes = 0;
+   int firstRow;
+   int slot;
+   memset(allColumns, 0b11111111, sizeof(allColumns));
+   beginDirectMode();
+   for (firstRow = 0; firstRow < FRAME_HEIGHT; firstRow += FRAME_BAND_ROWS) {
+      frameBeginBand(firstRow);
+      for (slot = 0; slot < equations; slot++) {
+         frameDrawExactTraceColumns(benchRows[slot], benchBreaks[slot], BENCH_FIRST_COLUMN, '1', 0,
+                                    FRAME_WIDTH - 1);
+      }
+      frameSetDirtyRegion(allColumns, 0, -1);
+      busBytes += frameFlushBand();
+   }
+   endDirectMode();
+   return busBytes;
+}
+
+// the pre-sweep drawGraph: sample every stale trace in turn, then render the bands
+static unsigned long perEquation(int equations, const PlotWindow *window)
+{
+   double xStep = ((BENCH_X_MAX - BENCH_X_MIN) / FRAME_WIDTH);
+   unsigned long evaluations = 0;
+   int slot;
+   HAL_CYCLES(CYCLES_FLOAT_ADD + CYCLES_FLOAT_DIV);
+   for (slot = 0; slot < equations; slot++) {
+      evaluations += sampleTrace(&benchCompiled[slot], window, BENCH_X_MIN, xStep, benchRows[slot],
+                                 benchBreaks[slot], BENCH_FIRST_COLUMN, BENCH_FIRST_COLUMN, FRAME_WIDTH);
+   }
+   renderBands(equations);
+   return evaluations;
+}
+
+static const unsigned char *layer(void)
+{
+   return (simGetVram() + simGetScreenBlockAddress(2));
+}
+
+int main(void)
+{
+   double windowBounds[6] = { BENCH_X_MIN, BENCH_X_MAX, BENCH_Y_MIN, BENCH_Y_MAX, 1.0, 1.0 };
+   PlotWindow window;
+   int equations;
+   int slot;
+   simReset();
+   firmwareMain();
+   plotWindowInit(&window, BENCH_X_MIN, BENCH_X_MAX, BENCH_Y_MIN, BENCH_Y_MAX, FRAME_WIDTH, FRAME_HEIGHT);
+   // the axes layer is drawn once here, so the rows below only cover the curves
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      clearExpression(&benchCompiled[slot]);
+   }
+   drawGraph(benchCompiled, windowBounds);
+   for (equations = 1; equations <= GRAPH_EQUATIONS; equations++) {
+      for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+         clearExpression(&benchCompiled[slot]);
+         if (slot < equations) {
+            compileExpression(benchEquations[slot], &benchCompiled[slot]);
+         }
+      }
+      printf("\n%d equation%s\n", equations, ((equations == 1) ? "" : "s"));
+
+      simBeginCall("per equation");
+      unsigned long evaluations = perEquation(equations, &window);
+      simEndCall();
+      memcpy(benchPicture, layer(), FRAME_LAYER_BYTES);
+      simBeginCall("per equation (redraw)");
+      renderBands(equations);
+      simEndCall();
+
+      graphInvalidateAll();
+      unsigned long before = graphGetEvaluations();
+      simBeginCall("fused sweep");
+      drawGraph(benchCompiled, windowBounds);
+      flushDisplayQueue();
+      simEndCall();
+      int differences = 0;
+      int i;
+      for (i = 0; i < FRAME_LAYER_BYTES; i++) {
+         if (layer()[i] != benchPicture[i]) {
+            differences++;
+         }
+      }
+      simBeginCall("fused sweep (re-entered)");
+      drawGraph(benchCompiled, windowBounds);
+      flushDisplayQueue();
+      simEndCall();
+      printf("   evaluations: %lu per equation, %lu fused; bytes that differ: %d\n", evaluations,
+             graphGetEvaluations() - before, differences);
+   }
+   printf("\n");
+   return 0;
+}
@@ -1,7 +1,16 @@
 #include <stdio.h>
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <util/delay.h>
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "Expression.h"
+#include "Graph.h"
+#include "Screens.h"
+#include "KeypadQueue.h"
+#include "Keypad.h"
+#include "Latency.h"
+#include "Diagnostics.h"
+#include "TextEditor.h"
+#include "Arena.h"
 
 // [Display Commands and Parameters]
    // system set commands and parameters
@@ -119,113 +128,156 @@
 
 // (For Port D, display pins DB5-DB0 correspond to Port D Pins 7-2)
 
+// [Port C Keypad Pins]
+   #define KEYPAD_PINS 0b00111111   // keypad lines on PC5-PC0 (PCINT13-PCINT8), any change wakes the scan
+
 // [Program Constants]
-   #define IN_BUFFER_SIZE 540            // size of inBuffer character array in bytes
    #define RESET_DELAY_DURATION 6        // duration of initial reset period in milliseconds
-   #define EQ_BUFFER_SIZE 120            // size of an equation holder
-   #define WINDOW_BOUNDS_SIZE 6          // size of array holding window bounds (in entries, not bytes)
-   #define TEXT_BUFFER_SIZE 200          // size of temporal buffer holding command line text
-   #define FUNCTION_TEXT_SEL_BUFFER_SIZE 3 // size of buffer for function selection
+   // (buffer sizes are in Arena.h)
+   #define TEXT_COLUMNS 40               // characters per text row (C/R)
+   #define KEYPAD_TICK_COUNTS ((KEYPAD_TICK_US * (F_CPU / 1000000UL)) / LATENCY_TIMER_PRESCALER)   // 250 Timer1 counts
+
+// [Screen and Input Routines]
+//    The keypad decoding and the text screens' drawing code are not part of this tree; these are
+//    the calls main() makes into them. The drawing routines return the text cursor position they
+//    leave (see Screens.h), the parsers a negative number or '0' when the text is rejected.
+   unsigned char getKeypadInput();
+   char decodeRawChar(unsigned char rawKey, char altFunction);
+   char getInputType(char currentChar, char mode);
+   char getNextMode(char currentChar);
+   char checkValidExpression(const char *text, char isEquation);
+   int parseFunctionChoice(const char *text);
+   int pasteSpecialFunction(int functionChoice, TextEditor *editor);
+   int updateWindowBounds(double *windowBounds, const char *text);
+   int drawCharacter(char character, int position, char moveCursor);
+   int drawCommandLine(const char *text, int textCursorPos);
+   int printCmdOutput(int textCursorPos, const char *text, const CompiledExpression *expression);
+   int clearBuffer(int textCursorPos);
+   int moveTextCursor(int textCursorPos, int offset);
+   int updateScreenCursor(int textCursorPos);
+   int drawEquationScreen(EquationSlot *equations, char currentEquation);
+   int drawEquationsMenuScreen(EquationSlot *equations);
+   int drawSpecialFunctionsScreen(char prevMode, const char *text);
+   int drawMenuScreen(char prevMode);
+   char compileEquation(const char *equation, int slot);
+   void initDisplay();
 
-// global volatile variables for display output
-//    > char byteToSend
-//    > char byteSent
-//    > keypad input buffer
-//    > input buffer write index
+// global volatile variables
+//    > (display transmit queue lives in DisplayBus.c, keypad queue in KeypadQueue.c, text buffers in Arena.c)
 //    > int numDClockIntervals
 
-volatile unsigned char byteToSend;           // byte that is to be sent (or was last sent)
-volatile char byteAwaitingTransmission;      // flag to tell interrupt it needs to send byteToSend
-volatile char isCommand;                     // flag used to determine whether A0 will be low or high
-volatile unsigned char* volatile inBuffer;   // buffer for keypad input
-volatile unsigned char prevInput;            // used to ensure accurate keypress detection (always 1 character per button push/release)
-volatile unsigned int nextBufferIndex;       // used to determine next index available to write to in buffer (unless buffer is full)
 
-// timer 0 is used to generate the display's clock signal
-static inline void initTimer0(void)
+// timer 1 counts freely at F_CPU / 64, the latency clock in builds with LATENCY_TIMING (see
+// Latency.h); its compare match is the 1 ms keypad scan tick and only runs while a key is down or settling (see Keypad.h)
+static inline void initTimer1(void)
 {
-   TCCR0A |=  (1 << WGM01);   // put timer in CTC mode
-   TCCR0B |= (1 << CS01);     // timer counts every 8 clock cycles
-   TIMSK0 |= (1 << OCIE0A);   // set to interrupt on compare
-   OCR0A = 10; // interrupt triggered every 80 clock cycles to generate display clock (~200 kHz)
-   TCNT0 = 0;
+   TCCR1B |= ((1 << CS11) | (1 << CS10));   // normal mode
+#ifdef LATENCY_TIMING
+   TIMSK1 |= (1 << TOIE1);
+#endif
+   TCNT1 = 0;
 }
 
-// timer 1 is used for polling the keypad once every ~80 milliseconds (doubles as a debouncer)
-static inline void initTimer1(void)
+#ifdef LATENCY_TIMING
+ISR(TIMER1_OVF_vect)
 {
-   TCCR1B |= ((1 << WGM12) | (1 << CS12) | (1 << CS10));
-   TIMSK1 |= (1 << OCIE1A);
-   OCR1A = 1250;
-   TCNT1 = 0;
+   latencyClockOverflow();
 }
+#endif
 
-ISR(TIMER0_COMPA_vect)
+// a pin change on the keypad lines wakes the scan tick; the change stays off while it runs
+static inline void initKeypadWakeup(void)
 {
-   PORTB ^= CLOCK_PIN;
-   if (((PORTB & CLOCK_PIN) == CLOCK_PIN) && (byteAwaitingTransmission == '1')) {
-      if (isCommand == '1') {
-         PORTB |= A0_PIN;
-      } else if ((PORTB & A0_PIN) == A0_PIN) {
-         PORTB ^= A0_PIN;
-      }
-      int i;
-      for (i = 7; i >= 0; i--) {
-         if (i >= 6) {
-            unsigned char mask;
-            if (i == 7) {
-               mask = DB7_PIN;
-            } else {
-               mask = DB6_PIN;
-            }
-            if ((byteToSend & (1 << i)) == (1 << i)) {
-               PORTB |= mask;
-            } else if ((PORTB & mask) == mask) {
-               PORTB ^= mask;
-            }
-         } else if ((byteToSend & (1 << i)) == (1 << i)) {
-            PORTD |= (1 << (i+2));
-         } else if ((PORTD & (1 << (i+2))) == (1 << (i+2))) {
-            PORTD ^= (1 << (i+2));
-         }
-      }
-      byteAwaitingTransmission = '0';
-   } else if ((PORTB & CLOCK_PIN) == CLOCK_PIN) {
-      PORTB = CLOCK_PIN;
-      PORTD = 0b00000000;
-   }/* else {
-      PORTB = 0b00000000;
-      PORTD = 0b00000000;
-   }*/   
+   PCMSK1 |= KEYPAD_PINS;
+   PCICR |= (1 << PCIE1);
+}
+
+ISR(PCINT1_vect)
+{
+   PCICR &= ~(1 << PCIE1);
+   OCR1A = (TCNT1 + KEYPAD_TICK_COUNTS);
+   TIFR1 = (1 << OCF1A);   // drop a match left over from the last scan
+   TIMSK1 |= (1 << OCIE1A);
 }
 
 ISR(TIMER1_COMPA_vect)
 {
+   OCR1A += KEYPAD_TICK_COUNTS;
    sei();   // allow ISR for timer0 to interrupt this ISR
-   unsigned char currentInput = getKeypadInput();
-   char isValidInput = checkValidInput(currentInput, prevInput);
-   if ((isValidInput == '1') && (inBuffer != NULL)) {
-      if (nextBufferIndex < ((sizeOf(inBuffer))-1)) {
-         inBuffer[nextBufferIndex] = currentInput;
-         nextBufferIndex++;
-      } else {
-         removeFromString(inBuffer, 0);
-         inBuffer[(sizeOf(inBuffer)-1)] = currentInput;
-         nextBufferIndex = ((sizeOf(inBuffer))-1);
+   if (keypadTick(getKeypadInput()) == '0') {
+      // idle: stop the tick and wait for the next change (PCIF1 still holds one that came
+      // after the last reading, so re-enabling cannot miss a key)
+      TIMSK1 &= ~(1 << OCIE1A);
+      PCICR |= (1 << PCIE1);
+   }
+}
+
+#if DIAGNOSTICS_LINES > 0
+// the hidden diagnostics screen: key-to-pixel latency and bus bytes per operation (see Diagnostics.h)
+static void drawDiagnosticsScreen(char redraw)
+{
+   char text[TEXT_COLUMNS];
+   int line;
+   busProfileBegin(BUS_OP_MENUS);
+   if (redraw == '1') {
+      fillDisplayMemory(screenGetAddress(), ' ', FRAME_TEXT_LAYER_BYTES);
+   }
+   for (line = 0; line < DIAGNOSTICS_LINES; line++) {
+      diagnosticsFormatLine(line, text, TEXT_COLUMNS);
+      writeDisplayMemory(screenGetAddress() + (line * TEXT_COLUMNS), (const unsigned char *) text, TEXT_COLUMNS);
+   }
+   busProfileEnd();
+}
+#endif
+
+// raw keys that decode to a cursor key with or without the alt function: those repeat when held
+static unsigned long cursorKeys(void)
+{
+   unsigned long repeatKeys = 0;
+   unsigned char rawKey;
+   for (rawKey = 1; rawKey <= KEYPAD_KEYS; rawKey++) {
+      char plain = decodeRawChar(rawKey, '0');
+      char alt = decodeRawChar(rawKey, '1');
+      if ((plain == '<') || (plain == '>') || (alt == '<') || (alt == '>')) {
+         repeatKeys |= (1UL << rawKey);
+      }
+   }
+   return repeatKeys;
+}
+
+// first of the GRAPH_SPLIT_TEXT_ROWS command line rows shown under a split graph: the ones ending
+// with the cursor's row, so the command line scrolls up as output is printed
+static unsigned int commandBlockAddress(int textCursorPos)
+{
+   int firstRow = ((textCursorPos / TEXT_COLUMNS) - (GRAPH_SPLIT_TEXT_ROWS - 1));
+   if (firstRow < 0) {
+      firstRow = 0;
+   }
+   return (screenGetAddress() + (firstRow * TEXT_COLUMNS));
+}
+
+// redraws the characters the last edits changed (origin = screen position of the editor's first
+// character) and returns the screen position of its cursor
+static int drawEditorChange(TextEditor *editor, int origin)
+{
+   int first;
+   int last;
+   int position;
+   if (editorTakeChange(editor, &first, &last) == '1') {
+      busProfileBegin(BUS_OP_EDIT);
+      for (position = first; position <= last; position++) {
+         drawCharacter(editorCharAt(editor, position), origin + position, '0');
       }
+      busProfileEnd();
    }
-   prevInput = currentInput;
+   return (origin + editorGetCursor(editor));
 }
 
 int main(void)
 {
-   byteToSend = 0b00000000;
-   byteAwaitingTransmission = '0';
-   isCommand = '0';
-   inBuffer = (volatile unsigned char * ) malloc(IN_BUFFER_SIZE);
-   fillWithNulls(inBuffer);
-   prevInput = 0b00000000;
-   nextBufferIndex = 0;
+   initLatency();
+   initKeypadQueue();
+   initKeypad(cursorKeys());
    DDRB = 0b00111111;
    DDRD = 0b11111110;
    PORTB = 0b00000000;
@@ -235,104 +287,47 @@ int main(void)
    PORTB = 0b00000000;
    initTimer0();
    initTimer1();
+   initKeypadWakeup();
    sei();
-   initDisplay();
-   char *equationA = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equA);
-   char *equationB = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equB);
-   char *equationC = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equC);
-   char *equationD = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equD);
-   char *equationE = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equE);
-   char *equationF = (char * ) malloc(EQ_BUFFER_SIZE);
-   fillWithNulls(equF);
-   char *textBuffer = (char * ) malloc(TEXT_BUFFER_SIZE);
-   fillWithNulls(textBuffer);
-   char *functionTextSelBuffer = (char * ) malloc(FUNCTION_TEXT_SEL_BUFFER_SIZE);
-   fillWithNulls(functionTextSelBuffer);
-   int textBufferIndex = 0;
-   int equationIndex = 0;
-   int functionIndex = 0;
-   double *windowBounds = (double * ) malloc((WINDOW_BOUNDS_SIZE*sizeOf(double)));
+   BUS_PROFILED(BUS_OP_INIT, initDisplay());
+   initArena();   // every text and window buffer is static (see Arena.h)
+   TextEditor *commandEditor = &arena.commandEditor;
+   TextEditor *functionEditor = &arena.functionEditor;
    char prevMode = 'c';
    char mode = 'c';
    char altFunction = '0';
    int textCursorPos = 0;
    char currentEquation = '0';
    char specialFunctionPasted = '0';
+   char splitScreen = '0';          // '1' while the graph leaves room for the command line under it
+   char commandUnderGraph = '0';    // '1' while the command line is used under the (split) graph
    int currentSpecFuncType = -1;
-   textCursorPos = drawCommandLine(textBuffer, textCursorPos);
+   BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = drawCommandLine(editorText(commandEditor), textCursorPos));
    while (1) {
-      while (nextBufferIndex > 0) {
-         unsigned char currentRawChar = inBuffer[0];
+      unsigned char currentRawChar;
+      latencyPoll();   // times the keys whose pixels have gone out since the last pass
+      while (keypadDequeue(&currentRawChar) == '1') {
          char currentChar = decodeRawChar(currentRawChar, altFunction);
          char currentInputType = getInputType(currentChar, mode);
+         // the text the keys edit in this mode, NULL on screens without one
+         TextEditor *editor = ((mode == 'c') ? commandEditor
+                               : ((mode == 'e') ? &arenaEquation(currentEquation - 'a')->editor
+                                  : ((mode == 'f') ? functionEditor : NULL)));
          switch (currentInputType) {
             case 'p':
-               if (mode == 'c') {
-                  if (textBufferIndex < (sizeOf(textBuffer)-1)) {
-                     textBuffer[textBufferIndex] = currentChar;
-                     textBufferIndex++;
-                     textCursorPos = drawCharacter(currentChar, textCursorPos, '0');
-                  }
-               } else if (mode == 'e') {
-                  switch (currentEquation) {
-                     case 'a':
-                        if (equationIndex < (sizeOf(equA)-1)) {
-                           equA[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        }
-                        break;
-                     case 'b':
-                        if (equationIndex < (sizeOf(equB)-1)) {
-                           equB[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        } 
-                        break;
-                     case 'c':
-                        if (equationIndex < (sizeOf(equC)-1)) {
-                           equC[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        }
-                        break;
-                     case 'd':
-                        if (equationIndex < (sizeOf(equD)-1)) {
-                           equD[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        }
-                        break;
-                     case 'e':
-                        if (equationIndex < (sizeOf(equE)-1)) {
-                           equE[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        }
-                        break;
-                     case 'f':
-                        if (equationIndex < (sizeOf(equF)-1)) {
-                           equF[equationIndex] = currentChar;
-                           equationIndex++;
-                           textCursorPos = drawCharacter(currentChar, textCursorPos, '0');  
-                        }
-                        break;
-                  }
-               } else if (mode == 'f') {
-                  if (functionIndex < (sizeOf(functionTextSelBuffer)-1)) {
-                     functionTextSelBuffer(functionIndex) = currentChar;
-                     functionIndex++;
-                     textCursorPos = drawCharacter(currentChar, textCursorPos, '0');
+               if (editor != NULL) {
+                  int origin = (textCursorPos - editorGetCursor(editor));
+                  if (mode == 'e') {
+                     screenInvalidate('q');   // the equations menu lists the text being edited
                   }
-               }      
+                  editorInsert(editor, currentChar);
+                  textCursorPos = drawEditorChange(editor, origin);
+               }
                break;
             case 'a':
+               cli();   // in/eor/out: the display ISR writes PORTB too
                PORTB ^= LED_PIN;
+               sei();
                if (altFunction == '0') {
                   altFunction = '1';
                } else {
@@ -342,227 +337,239 @@ int main(void)
             case 't':
                prevMode = mode;
                mode = getNextMode(currentChar);
+               if (prevMode != 'g') {
+                  screenSetCursor(textCursorPos);
+               }
+               commandUnderGraph = '0';
+               // every screen stays in display memory: only a stale one is drawn again
                switch (mode) {
                   case 'c':
-                     textCursorPos = drawCommandLine(textBuffer, textCursorPos);
+                     if ((splitScreen == '1') && (prevMode == 'g')) {
+                        // the command line opens under the graph, which stays on screen
+                        if (selectScreen('c', '0') == '0') {
+                           BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = drawCommandLine(editorText(commandEditor), textCursorPos));
+                        } else {
+                           textCursorPos = screenGetCursor();
+                           BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                        }
+                        commandUnderGraph = '1';
+                     } else if (showScreen('c', '0') == '0') {
+                        BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = drawCommandLine(editorText(commandEditor), textCursorPos));
+                     } else {
+                        textCursorPos = screenGetCursor();
+                        BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                     }
                      break;
                   case 'g':
-                     drawGraph(equA, equB, equC, equD, equE, equF, windowBounds);
+                     if (prevMode == 'g') {
+                        // the graph key on the graph switches the command line under it on or off
+                        splitScreen = ((splitScreen == '1') ? '0' : '1');
+                        graphSetSplit(splitScreen);
+                     }
+                     if (splitScreen == '1') {
+                        if (selectScreen('c', '0') == '0') {
+                           BUS_PROFILED(BUS_OP_COMMAND_LINE, screenSetCursor(drawCommandLine(editorText(commandEditor), screenGetCursor())));
+                        }
+                        graphShowText(commandBlockAddress(screenGetCursor()));
+                     }
+                     drawGraph(arena.compiledEquations, arena.windowBounds);
                      break;
                   case 'e':
-                     switch (currentChar) {
-                        case 1:
-                           currentEquation = 'a';
-                           break;
-                        case 2:
-                           currentEquation = 'b';
-                           break;
-                        case 3:
-                           currentEquation = 'c';
-                           break;
-                        case 4:
-                           currentEquation = 'd';
-                           break;
-                        case 5:
-                           currentEquation = 'e';
-                           break;
-                        case 6:
-                           currentEquation = 'f';
-                           break;
-                     }      
-                     textCursorPos = drawEquationScreen(equA, equB, equC, equD, equE, equF, currentEquation);
-                     equationIndex = textCursorPos;
+                     if ((currentChar >= 1) && (currentChar <= GRAPH_EQUATIONS)) {
+                        currentEquation = ('a' + (currentChar - 1));   // keys 1-6 pick equA..equF
+                     }
+                     if (showScreen('e', currentEquation) == '0') {
+                        // the screen leaves the cursor after the selected equation
+                        TextEditor *selected = &arenaEquation(currentEquation - 'a')->editor;
+                        BUS_PROFILED(BUS_OP_EQUATIONS, textCursorPos = drawEquationScreen(arena.equations, currentEquation));
+                        editorSetCursor(selected, editorGetLength(selected));
+                     } else {
+                        textCursorPos = screenGetCursor();
+                        BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                     }
                      break;
                   case 'f':
-                     textCursorPos = drawSpecialFunctionsScreen(prevMode, functionTextSelBuffer);
-                     functionIndex = (sizeOf(SPEC_FUNC_TEXT) - 1 - textCursorPos);
+                     if (showScreen('f', prevMode) == '0') {
+                        BUS_PROFILED(BUS_OP_MENUS, textCursorPos = drawSpecialFunctionsScreen(prevMode, editorText(functionEditor)));
+                        editorSetCursor(functionEditor, editorGetLength(functionEditor));
+                     } else {
+                        textCursorPos = screenGetCursor();
+                        BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                     }
                      break;
                   case 'm':
-                     drawMenuScreen(prevMode);
+#if DIAGNOSTICS_LINES > 0
+                     if (prevMode == 'm') {
+                        // the menu key on the menu opens the hidden diagnostics screen
+                        mode = 'x';
+                        drawDiagnosticsScreen((showScreen('x', '0') == '1') ? '0' : '1');
+                        break;
+                     }
+#endif
+                     if (showScreen('m', prevMode) == '0') {
+                        BUS_PROFILED(BUS_OP_MENUS, drawMenuScreen(prevMode));
+                     }
                      break;
                   case 'q':
-                     drawEquationsMenuScreen(equA, equB, equC, equD, equE, equF);
+                     if (showScreen('q', '0') == '0') {
+                        BUS_PROFILED(BUS_OP_EQUATIONS, drawEquationsMenuScreen(arena.equations));
+                     }
                      break;
                }         
                break;
             case 'e':
                if (mode == 'c') {
-                  textCursorPos = printCmdOutput(textCursorPos, textBuffer);
+                  CompiledExpression commandExpression;   // only needed while the entry is printed
+                  compileExpression(editorText(commandEditor), &commandExpression);
+                  BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = printCmdOutput(textCursorPos, editorText(commandEditor), &commandExpression));
                   if (specialFunctionPasted == '1') {
                      if (currentSpecFuncType == 1) {
-                        textCursorPos = drawCommandLine(textBuffer, textCursorPos);
-                     } else if (currentSpecFunctionType == 2) {
-                        updateWindowBounds(windowBounds, textBuffer);
+                        BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = drawCommandLine(editorText(commandEditor), textCursorPos));
+                     } else if (currentSpecFuncType == 2) {
+                        updateWindowBounds(arena.windowBounds, editorText(commandEditor));
                      }   
                      specialFunctionPasted = '0';
-                     currentSpecFunctionType = -1;
+                     currentSpecFuncType = -1;
                   }      
-                  textCursorPos = clearBuffer(textCursorPos, textBuffer);
-                  textBufferIndex = 0;
+                  editorClear(commandEditor);
+                  BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = clearBuffer(textCursorPos));
                } else if (mode == 'e') {
-                  switch (currentEquation) {
-                     case 'a':
-                        checkValidExpression(equA, '1');
-                        break;
-                     case 'b':
-                        checkValidExpression(equB, '1');
-                        break;
-                     case 'c':
-                        checkValidExpression(equC, '1');
-                        break;
-                     case 'd':
-                        checkValidExpression(equD, '1');
-                        break;
-                     case 'e':
-                        checkValidExpression(equE, '1');
-                        break;
-                     case 'f':
-                        checkValidExpression(equF, '1');
-                        break;
-                  }
+                  compileEquation(editorText(&arenaEquation(currentEquation - 'a')->editor), currentEquation - 'a');
                   prevMode = mode;
                   mode = 'q';
-                  drawEquationsMenuScreen(equA, equB, equC, equD, equE, equF);
+                  screenSetCursor(textCursorPos);
+                  if (showScreen('q', '0') == '0') {
+                     BUS_PROFILED(BUS_OP_EQUATIONS, drawEquationsMenuScreen(arena.equations));
+                  }
                } else if (mode == 'f') {
-                  int functionChoice = parseFunctionChoice(functionTextSelBuffer);
+                  int functionChoice = parseFunctionChoice(editorText(functionEditor));
                   if (functionChoice >= 0) {
                      currentSpecFuncType = functionChoice;
                      mode = prevMode;
                      prevMode = 'f';
+                     screenSetCursor(textCursorPos);
                      if (mode == 'c') {
-                        textCursorPos = drawCommandLine(textBuffer, textCursorPos);
-                        int prevTextCursorPos = textCursorPos;
-                        textCursorPos = pasteSpecialFunction(functionChoice, textBuffer, textCursorPos);
-                        textBufferIndex += (textCursorPos - prevTextCursorPos);
+                        if (showScreen('c', '0') == '0') {
+                           BUS_PROFILED(BUS_OP_COMMAND_LINE, textCursorPos = drawCommandLine(editorText(commandEditor), textCursorPos));
+                        } else {
+                           textCursorPos = screenGetCursor();
+                           BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                        }
+                        // the function's text goes in through editorInsert, drawn like typed characters
+                        int origin = (textCursorPos - editorGetCursor(commandEditor));
+                        pasteSpecialFunction(functionChoice, commandEditor);
+                        textCursorPos = drawEditorChange(commandEditor, origin);
                      } else if (mode == 'e') {
-                        textCursorPos = drawEquationScreen(equA, equB, equC, equD, equE, equF, currentEquation);
-                        int prevTextCursorPos = textCursosPos;
-                        switch (currentEquation) {
-                           case 'a':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equA, textCursorPos);
-                              break;
-                           case 'b':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equB, textCursorPos);
-                              break;
-                           case 'c':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equC, textCursorPos);
-                              break;
-                           case 'd':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equD, textCursorPos);
-                              break;
-                           case 'e':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equE, textCursorPos);
-                              break;
-                           case 'f':
-                              textCursorPos = pasteSpecialFunction(functionChoice, equF, textCursorPos);
-                              break;
+                        TextEditor *selected = &arenaEquation(currentEquation - 'a')->editor;
+                        if (showScreen('e', currentEquation) == '0') {
+                           BUS_PROFILED(BUS_OP_EQUATIONS, textCursorPos = drawEquationScreen(arena.equations, currentEquation));
+                           editorSetCursor(selected, editorGetLength(selected));
+                        } else {
+                           textCursorPos = screenGetCursor();
+                           BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
                         }
-                        equationIndex += (textCursorPos - prevTextCursorPos);
+                        int origin = (textCursorPos - editorGetCursor(selected));
+                        screenInvalidate('q');
+                        pasteSpecialFunction(functionChoice, selected);
+                        textCursorPos = drawEditorChange(selected, origin);
                      }         
                      specialFunctionPasted = '1';
                   }
                }   
                break;
             case 'c':
-               int offset = 0;
-               if (currentChar == '<') {
-                  if ((textBufferIndex > 0) && (mode == 'c')) {
-                     offset = -1;
-                     textBufferIndex--;
-                  } else if ((equationIndex > 0) && (mode == 'e') {
-                     offset = -1;
-                     equationIndex--;
-                  } else if ((functionIndex > 0) && (mode == 'f') {
-                     offset = -1;
-                     functionIndex--;
-                  }      
-               } else if (currentChar == '>') {
-                  if ((textBufferIndex < (strlen(textBuffer)-1)) && (mode == 'c')) {
-                     offset = 1;
-                     textBufferIndex++;
-                  } else if (mode == 'e') {
-                     int currEqLength = 0;
-                     switch (currentEquation) {
-                        case 'a':
-                           currEqLength = (strlen(equA)-1);
-                           break;
-                        case 'b':
-                           currEqLength = (strlen(equB)-1);
-                           break;
-                        case 'c':
-                           currEqLength = (strlen(eqC)-1);
-                           break;
-                        case 'd':
-                           currEqLength = (strlen(equD)-1);
-                           break;
-                        case 'e':
-                           currEqLength = (strlen(equE)-1);
-                           break;
-                        case 'f':
-                           currEqLength = (strlen(equF)-1);
-                           break;
-                     }
-                     if (equationIndex < currEqLength) {
-                        offset = 1;
-                        equationIndex++;
-                     }         
-                  } else if ((mode == 'f') && (functionIndex < (strlen(functionTextSelBuffer)-1))) {
-                     offset = 1;
-                     functionIndex++;
-                  }   
-               }    
-               textCursorPos = moveTextCursor(textCursorPos, offset);
-               updateScreenCursor(textCursorPos);   
+               if (editor != NULL) {
+                  int offset = ((currentChar == '<') ? -1 : ((currentChar == '>') ? 1 : 0));
+                  if ((offset != 0) && (editorMoveCursor(editor, offset) == '1')) {
+                     BUS_PROFILED(BUS_OP_CURSOR, textCursorPos = moveTextCursor(textCursorPos, offset));
+                     BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
+                  }
+               }
                break;
             case 'd':
-               if (mode == 'c') {
-                  removeFromString(textBuffer, textBufferIndex); 
-               } else if (mode == 'f') {
-                  removeFromString(functionTextSelBuffer, functionIndex);
-               } else if (mode == 'e') {
-                  switch (currentEquation) {
-                     case 'a':
-                        removeFromString(equA, equationIndex);
-                        break;
-                     case 'b':
-                        removeFromString(equB, equationIndex);
-                        break;
-                     case 'c':
-                        removeFromString(equC, equationIndex);
-                        break;
-                     case 'd':
-                        removeFromString(equD, equationIndex);
-                        break;
-                     case 'e':
-                        removeFromString(equE, equationIndex);
-                        break;
-                     case 'f':
-                        removeFromString(equF, equationIndex);
-                        break;
+               if (editor != NULL) {
+                  int origin = (textCursorPos - editorGetCursor(editor));
+                  if (editorDelete(editor) == '1') {
+                     if (mode == 'e') {
+                        screenInvalidate('q');
+                     }
+                     textCursorPos = drawEditorChange(editor, origin);
+                     BUS_PROFILED(BUS_OP_CURSOR, updateScreenCursor(textCursorPos));
                   }
-               }           
+               }
                break;
          }
-         removeFromString(inBuffer, 0);
-         nextBufferIndex--;
+         if (commandUnderGraph == '1') {
+            graphShowText(commandBlockAddress(textCursorPos));   // one C_SCROLL when a new row is reached
+         }
+         latencyKeyHandled(currentInputType, keypadGetStamp());   // timed once the queue drains
+         latencyPoll();
       }
+      // no key waiting: one strip of preparing the graph pages for a pan (does nothing unless
+      // the graph is shown)
+      graphIdle(arena.compiledEquations);
    }
 }
 
-char checkValidInput(unsigned char currentInput, unsigned char prevInput)
+// the text is parsed once here; graphing and evaluation only ever run the bytecode. Accepting
+// a text that compiles to the code the slot already holds leaves the graph as it is (the
+// equations menu was invalidated by the edits themselves).
+char compileEquation(const char *equation, int slot)
 {
-   if (currentInput == prevInput) {
-      return '0';
-   } else {
-      int numInput = ((int) currentInput);
-      if ((numInput >= 1) && (numInput <= 20)) {
-         return '1';
-      } else {
-         return '0';
-      }
+   CompiledExpression compiled;
+   char accepted = '0';
+   clearExpression(&compiled);
+   if (checkValidExpression(equation, '1') == '1') {
+      accepted = compileExpression(equation, &compiled);
+   }
+   if (expressionsEqual(&compiled, &arena.compiledEquations[slot]) == '0') {
+      arena.compiledEquations[slot] = compiled;
+      graphInvalidateAll();
    }
-}            
+   return accepted;
+}
+
+// [Display Setup]
+//    Same sequence as the graphics demo's initDisplay(): the controller gets each command with a
+//    5 ms pause, the text pages are cleared to spaces and the graph layers to 0 with the display
+//    off, and screen block 1 shows text page 0 over the graphics layer (frameScroll's reset state).
+static void sendSetupCommand(unsigned char command, const unsigned char *params, unsigned char numParams)
+{
+   sendCommandToDisplay(command, params, numParams);
+   flushDisplayQueue();
+   _delay_ms(5);
+}
 
 void initDisplay()
 {
-   
\ No newline at end of file
+   const unsigned char systemSetParams[8] = {
+      P_SYS_SET_P1_SMALL, P_SYS_SET_P2_SMALL, P_SYS_SET_P3_SMALL, P_SYS_SET_P4,
+      P_SYS_SET_P5, P_SYS_SET_P6, P_SYS_SET_P7, P_SYS_SET_P8
+   };
+   const unsigned char scrollParams[8] = {
+      P_SCROLL_P1, P_SCROLL_P2, P_SCROLL_P3_MONO, P_SCROLL_P4_MONO,
+      P_SCROLL_P5_MONO, P_SCROLL_P6_MONO, P_SCROLL_P7_MONO, P_SCROLL_P8_MONO
+   };
+   const unsigned char cursorFormParams[2] = {P_CSRFORM_P1_SMALL, P_CSRFORM_P2_SMALL};
+   unsigned char param;
+   sendSetupCommand(C_SYS_SET, systemSetParams, 8);
+   sendSetupCommand(C_SCROLL, scrollParams, 8);
+   param = P_HDOT_SCR;
+   sendSetupCommand(C_HDOT_SCR, &param, 1);
+   param = P_OVERLAY;
+   sendSetupCommand(C_OVERLAY, &param, 1);
+   param = P_DISP_ATTRIB_NOCURSOR;
+   sendSetupCommand(C_DISP_OFF, &param, 1);
+   setCursorDirection();
+   busProfileBegin(BUS_OP_CLEAR);
+   beginDirectMode();
+   fillDisplayMemory(0x0000, ' ', (FRAME_TEXT_PAGES * FRAME_TEXT_LAYER_BYTES));
+   fillDisplayMemory((FRAME_TEXT_PAGES * FRAME_TEXT_LAYER_BYTES), 0b00000000,
+                     (unsigned int) (FRAME_VRAM_SIZE - (FRAME_TEXT_PAGES * FRAME_TEXT_LAYER_BYTES)));
+   endDirectMode();
+   busProfileEnd();
+   setCursorAddress(0x0000);
+   sendSetupCommand(C_CSRFORM, cursorFormParams, 2);
+   param = P_DISP_ATTRIB_CURSOR;
+   sendSetupCommand(C_DISP_ON, &param, 1);
+}
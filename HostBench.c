@@ -0,0 +1,144 @@
+#include <stdio.h>
+#define HOST_PROGRAM
+#include "DisplayHAL.h"
+#include "SED1335Sim.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "Expression.h"
+#include "Graph.h"
+#include "KeypadQueue.h"
+
+// [Host Benchmark Suite]
+//    The hot paths on the host model, one CSV row each: the full-screen clear, the demo curves,
+//    drawGraph with 1 to 6 equations, expression evaluation and the keypad ring. Columns:
+//    > group, name: what was measured
+//    > operations: how many times it ran (the per-operation figure divides by this)
+//    > cycles, cycles_per_op: simulated AVR cycles, display queue drained at the end
+//    > command_bytes, data_bytes, vram_bytes, csrw: bus traffic as the model decoded it
+//    The model is deterministic, so the figures only move when the code does. `make bench`
+//    writes them to host_build/bench.csv. `make bench-check` fails when a row costs more cycles
+//    or bus bytes than BenchBaseline.csv allows (see BENCH_TOLERANCE_PERCENT in the Makefile).
+
+#define BENCH_X_MIN -10.0
+#define BENCH_X_MAX 10.0
+#define BENCH_Y_MIN -10.0
+#define BENCH_Y_MAX 10.0
+#define BENCH_COLUMNS 320
+#define BENCH_KEYS (KEYPAD_QUEUE_SIZE - 1)   // keys the ring holds
+
+// simplest first, so each added slot makes the sweep costlier
+static const char *benchEquations[GRAPH_EQUATIONS] = {
+   "x/2",
+   "x^2/4-3",
+   "3sin(x)",
+   "x^3/20-x",
+   "tan(x)",
+   "e^(-x^2/8)*6"
+};
+
+// firmware entry points (DisplayDemoGraphicsOnly.c)
+int firmwareMain(void);
+int clearAllDisplayMemory();
+int drawPosLine();
+int drawNegLine();
+int drawParabola();
+
+static CompiledExpression benchCompiled[GRAPH_EQUATIONS];
+static SimCounters benchStart;
+
+static void benchBegin(void)
+{
+   benchStart = simGetTotals();
+}
+
+static void benchEnd(const char *group, const char *name, unsigned long operations)
+{
+   flushDisplayQueue();
+   SimCounters end = simGetTotals();
+   unsigned long long cycles = (end.cpuCycles - benchStart.cpuCycles);
+   printf("%s,%s,%lu,%llu,%llu,%lu,%lu,%lu,%lu\n", group, name, operations, cycles, cycles / operations,
+          end.commandBytes - benchStart.commandBytes, end.dataBytes - benchStart.dataBytes,
+          end.vramBytes - benchStart.vramBytes, end.csrwCommands - benchStart.csrwCommands);
+}
+
+static void benchGraphs(void)
+{
+   double windowBounds[6] = { BENCH_X_MIN, BENCH_X_MAX, BENCH_Y_MIN, BENCH_Y_MAX, 1.0, 1.0 };
+   char name[24];
+   int equations;
+   int slot;
+   for (equations = 1; equations <= GRAPH_EQUATIONS; equations++) {
+      for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+         clearExpression(&benchCompiled[slot]);
+         if (slot < equations) {
+            compileExpression(benchEquations[slot], &benchCompiled[slot]);
+         }
+      }
+      graphInvalidateAll();
+      sprintf(name, "drawGraph %d cold", equations);
+      benchBegin();
+      drawGraph(benchCompiled, windowBounds);
+      benchEnd("graph", name, 1);
+      sprintf(name, "drawGraph %d re-entered", equations);
+      benchBegin();
+      drawGraph(benchCompiled, windowBounds);
+      benchEnd("graph", name, 1);
+   }
+}
+
+static void benchEvaluation(void)
+{
+   double step = ((BENCH_X_MAX - BENCH_X_MIN) / BENCH_COLUMNS);
+   int slot;
+   for (slot = 0; slot < GRAPH_EQUATIONS; slot++) {
+      double x = BENCH_X_MIN;
+      int col;
+      compileExpression(benchEquations[slot], &benchCompiled[slot]);
+      benchBegin();
+      for (col = 0; col < BENCH_COLUMNS; col++) {
+         evaluateExpression(&benchCompiled[slot], x);
+         x += step;
+      }
+      benchEnd("eval", benchEquations[slot], BENCH_COLUMNS);
+   }
+}
+
+static void benchKeypad(void)
+{
+   unsigned char key;
+   int i;
+   initKeypadQueue();
+   benchBegin();
+   for (i = 0; i < BENCH_KEYS; i++) {
+      keypadEnqueue((unsigned char) (1 + (i % 20)));
+   }
+   benchEnd("keypad", "enqueue", BENCH_KEYS);
+   benchBegin();
+   for (i = 0; i < BENCH_KEYS; i++) {
+      keypadDequeue(&key);
+   }
+   benchEnd("keypad", "dequeue", BENCH_KEYS);
+}
+
+int main(void)
+{
+   simReset();
+   firmwareMain();
+   printf("group,name,operations,cycles,cycles_per_op,command_bytes,data_bytes,vram_bytes,csrw\n");
+   benchBegin();
+   clearAllDisplayMemory();
+   benchEnd("display", "clearAllDisplayMemory", 1);
+   benchBegin();
+   drawPosLine();
+   benchEnd("demo", "drawPosLine", 1);
+   benchBegin();
+   drawNegLine();
+   benchEnd("demo", "drawNegLine", 1);
+   benchBegin();
+   drawParabola();
+   benchEnd("demo", "drawParabola", 1);
+   benchGraphs();
+   benchEvaluation();
+   benchKeypad();
+   return 0;
+}
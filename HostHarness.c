@@ -0,0 +1,470 @@
+#include <stdio.h>
+#include <string.h>
+#include "SED1335Sim.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "Expression.h"
+#include "Graph.h"
+#include "Screens.h"
+#include "KeypadQueue.h"
+#include "Keypad.h"
+#include "Latency.h"
+#include "Diagnostics.h"
+#include "TextEditor.h"
+#include "Arena.h"
+
+// [Host Harness]
+//    Runs the firmware's start-up path against the SED1335 model, then calls the display routines
+//    one by one and prints what each of them cost on the bus. Along the way CHECK() tests what each
+//    step must leave behind (pixels drawn, pages flipped, nothing evaluated for an unchanged graph,
+//    every bus byte profiled...); a failed check is printed with its line and main() returns 1, so
+//    `make check` fails.
+
+// firmware entry points (DisplayDemoGraphicsOnly.c)
+int firmwareMain(void);
+int initDisplay();
+int clearAllDisplayMemory();
+int drawPosLine();
+int drawNegLine();
+int drawParabola();
+int drawExpression(const CompiledExpression *expression);
+int systemSet();
+
+static int checkFailures;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(int passed, const char *condition, int line)
+{
+   if (!passed) {
+      printf("CHECK FAILED (HostHarness.c:%d): %s\n", line, condition);
+      checkFailures++;
+   }
+}
+
+// set pixels in the graphics layer, to check what the draw routines left on screen
+static unsigned long countBlockPixels(int block)
+{
+   const unsigned char *vram = simGetVram();
+   unsigned long pixels = 0;
+   unsigned int i;
+   for (i = 0; i < (FRAME_BYTES_PER_ROW * FRAME_HEIGHT); i++) {
+      unsigned char byte = vram[simGetScreenBlockAddress(block) + i];
+      while (byte != 0) {
+         pixels += (byte & 1);
+         byte >>= 1;
+      }
+   }
+   return pixels;
+}
+
+static unsigned char shownPicture[FRAME_LAYER_BYTES];
+
+static int countChangedBytes(unsigned int address)
+{
+   int changed = 0;
+   int i;
+   for (i = 0; i < FRAME_LAYER_BYTES; i++) {
+      if (simGetVram()[address + i] != shownPicture[i]) {
+         changed++;
+      }
+   }
+   return changed;
+}
+
+// the two graphics blocks overlaid (OR), as the screen shows them
+static void copyScreen(unsigned char *picture)
+{
+   const unsigned char *vram = simGetVram();
+   int i;
+   for (i = 0; i < FRAME_LAYER_BYTES; i++) {
+      picture[i] = (vram[simGetScreenBlockAddress(1) + i] | vram[simGetScreenBlockAddress(2) + i]);
+   }
+}
+
+// pixels on screen that differ from the picture copyScreen() put in shownPicture
+static unsigned long countScreenChanges(void)
+{
+   unsigned char picture[FRAME_LAYER_BYTES];
+   unsigned long pixels = 0;
+   int i;
+   copyScreen(picture);
+   for (i = 0; i < FRAME_LAYER_BYTES; i++) {
+      unsigned char byte = (picture[i] ^ shownPicture[i]);
+      while (byte != 0) {
+         pixels += (byte & 1);
+         byte >>= 1;
+      }
+   }
+   return pixels;
+}
+
+static unsigned long countLayerPixels(void)
+{
+   return countBlockPixels(2);
+}
+
+// returns the equation evaluations the draw took
+static unsigned long measureGraph(const char *name, const CompiledExpression *equations, const double *windowBounds)
+{
+   unsigned long evaluations = graphGetEvaluations();
+   simBeginCall(name);
+   drawGraph(equations, windowBounds);
+   flushDisplayQueue();
+   simEndCall();
+   evaluations = (graphGetEvaluations() - evaluations);
+   printf("   evaluations: %lu\n", evaluations);
+   return evaluations;
+}
+
+// keypad scan ticks (1 ms each) reading rawKey; keypadTick is the ISR's body
+static int keypadScanTick;
+static int keypadFirstKeyTick;
+
+static void feedKeypad(unsigned char rawKey, int ticks)
+{
+   while (ticks-- > 0) {
+      keypadScanTick++;
+      keypadTick(rawKey);
+      if ((keypadFirstKeyTick < 0) && (keypadQueueEmpty() == '0')) {
+         keypadFirstKeyTick = keypadScanTick;
+      }
+   }
+}
+
+static unsigned int drainKeypad(void)
+{
+   unsigned char key;
+   unsigned int keys = 0;
+   while (keypadDequeue(&key) == '1') {
+      keys++;
+   }
+   return keys;
+}
+
+int main(void)
+{
+   simReset();
+   simBeginCall("firmwareMain (reset + init)");
+   firmwareMain();
+   simEndCall();
+   CHECK(simGetState()->displayOn == '1');
+   simBeginCall("clearAllDisplayMemory");
+   clearAllDisplayMemory();
+   flushDisplayQueue();
+   simEndCall();
+   simBeginCall("drawPosLine");
+   drawPosLine();
+   flushDisplayQueue();
+   simEndCall();
+   printf("   graphics layer pixels after drawPosLine: %lu\n", countLayerPixels());
+   CHECK(countLayerPixels() > 0);
+   simBeginCall("drawNegLine");
+   drawNegLine();
+   flushDisplayQueue();
+   simEndCall();
+   printf("   graphics layer pixels after drawNegLine: %lu\n", countLayerPixels());
+   CHECK(countLayerPixels() > 0);
+   simBeginCall("drawParabola");
+   drawParabola();
+   flushDisplayQueue();
+   simEndCall();
+   printf("   graphics layer pixels after drawParabola: %lu\n", countLayerPixels());
+   CHECK(countLayerPixels() > 0);
+   // typed equations go through the bytecode compiler once and the interpreter once per column
+   CompiledExpression expression;
+   const char *equations[] = {"x^2/4-3", "3sin(x)", "tan(x)"};
+   unsigned int i;
+   for (i = 0; i < (sizeof(equations) / sizeof(equations[0])); i++) {
+      char label[SIM_CALL_NAME_SIZE];
+      CHECK(compileExpression(equations[i], &expression) == '1');
+      snprintf(label, sizeof(label), "drawExpression %s", equations[i]);
+      simBeginCall(label);
+      drawExpression(&expression);
+      flushDisplayQueue();
+      simEndCall();
+      printf("   %d instructions, graphics layer pixels: %lu\n", countInstructions(&expression), countLayerPixels());
+      CHECK(countLayerPixels() > 0);
+   }
+   // the graph screen, in the window the calculator starts with: entering it again without
+   // changes only shows the pages still in VRAM
+   CompiledExpression equationSlots[GRAPH_EQUATIONS];
+   initArena();
+   double *windowBounds = arena.windowBounds;
+   for (i = 0; i < GRAPH_EQUATIONS; i++) {
+      clearExpression(&equationSlots[i]);
+   }
+   for (i = 0; i < (sizeof(equations) / sizeof(equations[0])); i++) {
+      compileExpression(equations[i], &equationSlots[i]);
+   }
+   CHECK(measureGraph("drawGraph (3 equations, cold)", equationSlots, windowBounds) > 0);
+   printf("   axes layer (block 1, overlay 0x%02X) pixels: %lu\n", simGetState()->overlay, countBlockPixels(1));
+   CHECK((countBlockPixels(1) > 0) && (countBlockPixels(2) > 0));
+   CHECK(measureGraph("drawGraph (re-entered, unchanged)", equationSlots, windowBounds) == 0);
+   // accepting a text that compiles to the same code leaves the graph alone (compileEquation)
+   CHECK(compileExpression("3sin(x)", &expression) == '1');
+   CHECK(expressionsEqual(&expression, &equationSlots[1]) == '1');
+   compileExpression("x^3/20", &equationSlots[1]);
+   CHECK(expressionsEqual(&expression, &equationSlots[1]) == '0');
+   graphInvalidateAll();
+   // the redraw goes to the hidden page: the page on screen is untouched until the flip
+   unsigned int shownPage = simGetScreenBlockAddress(2);
+   memcpy(shownPicture, simGetVram() + shownPage, FRAME_LAYER_BYTES);
+   measureGraph("drawGraph (slot 1 edited)", equationSlots, windowBounds);
+   printf("   curve page flipped %u -> %u, bytes of the old page changed: %d\n", shownPage,
+          simGetScreenBlockAddress(2), countChangedBytes(shownPage));
+   CHECK((simGetScreenBlockAddress(2) != shownPage) && (countChangedBytes(shownPage) == 0));
+   windowBounds[WINDOW_X_MIN] = -5.0;
+   windowBounds[WINDOW_X_MAX] = 5.0;
+   unsigned long evaluations = graphGetEvaluations();
+   simBeginCall("drawGraph (window changed)");
+   drawGraph(equationSlots, windowBounds);
+   flushDisplayQueue();
+   SimCounters redraw = simEndCall();
+   unsigned long redrawEvaluations = (graphGetEvaluations() - evaluations);
+   printf("   evaluations: %lu\n", redrawEvaluations);
+   CHECK(redrawEvaluations > 0);
+   // while no key waits, both pages get the picture with the axes; nothing on screen changes
+   copyScreen(shownPicture);
+   simBeginCall("graphIdle (catch-up, all strips)");
+   int idleCalls = 1;
+   while (graphIdle(equationSlots) == '1') {
+      idleCalls++;
+   }
+   flushDisplayQueue();
+   simEndCall();
+   printf("   calls: %d, pixels changed on screen: %lu\n", idleCalls, countScreenChanges());
+   CHECK((idleCalls == FRAME_BYTES_PER_ROW) && (countScreenChanges() == 0));
+   // panning scrolls the picture with the graphics blocks' start address and only samples and
+   // sends what scrolled in, once for both pages: less than a redraw, given the idle time to
+   // catch up in between
+   const char *pans[] = {"panGraph (8 pixels right)", "panGraph (10 rows down)", "panGraph (8 pixels left)",
+                         "panGraph (30 rows up)"};
+   const int panColumns[] = {1, 0, -1, 0};
+   const int panRows[] = {0, 10, 0, -30};
+   for (i = 0; i < (sizeof(pans) / sizeof(pans[0])); i++) {
+      evaluations = graphGetEvaluations();
+      simBeginCall(pans[i]);
+      panGraph(equationSlots, windowBounds, panColumns[i], panRows[i]);
+      flushDisplayQueue();
+      SimCounters pan = simEndCall();
+      evaluations = (graphGetEvaluations() - evaluations);
+      printf("   evaluations: %lu, graphics block at %u\n", evaluations, simGetScreenBlockAddress(2));
+      CHECK((evaluations < redrawEvaluations) && (pan.dataBytes < redraw.dataBytes));
+      CHECK(simGetScreenBlockAddress(1) == simGetScreenBlockAddress(2));
+      while (graphIdle(equationSlots) == '1') {
+         // a page that reached the edge of its zone is drawn again in the middle
+      }
+   }
+   // a pan shows one page in both blocks (composite mode), and exactly the picture a redraw gives
+   copyScreen(shownPicture);
+   graphInvalidateAll();
+   drawGraph(equationSlots, windowBounds);
+   flushDisplayQueue();
+   unsigned long differing = countScreenChanges();
+   printf("   pixels that differ from a redraw: %lu\n", differing);
+   CHECK(differing == 0);
+   // mode switches: a text screen keeps its page and the graph its layers while the other is shown
+   simBeginCall("showScreen 'c' (first time, page drawn)");
+   char current = showScreen('c', '0');
+   if (current == '0') {
+      beginDirectMode();
+      fillDisplayMemory(screenGetAddress(), ' ', FRAME_TEXT_LAYER_BYTES);   // stands in for drawCommandLine
+      endDirectMode();
+   }
+   flushDisplayQueue();
+   simEndCall();
+   printf("   resident: %c, text page at %u\n", current, simGetScreenBlockAddress(1));
+   CHECK(simGetScreenBlockAddress(1) == screenGetAddress());
+   CHECK(measureGraph("drawGraph (back from 'c', unchanged)", equationSlots, windowBounds) == 0);
+   simBeginCall("showScreen 'c' (back from the graph)");
+   current = showScreen('c', '0');
+   flushDisplayQueue();
+   simEndCall();
+   printf("   resident: %c, text page at %u, overlay 0x%02X\n", current, simGetScreenBlockAddress(1),
+          simGetState()->overlay);
+   CHECK((current == '1') && (simGetScreenBlockAddress(1) == screenGetAddress()));
+   // split screen: the command line under a shorter graph; typing there leaves the graph alone
+   graphSetSplit('1');
+   measureGraph("drawGraph (split screen)", equationSlots, windowBounds);
+   printf("   graph lines %d, command line (block 3) at %u, block 4 at %u\n", simGetState()->scroll[2] + 1,
+          simGetScreenBlockAddress(3), simGetScreenBlockAddress(4));
+   CHECK((simGetState()->scroll[2] + 1) == (FRAME_HEIGHT - (8 * GRAPH_SPLIT_TEXT_ROWS)));
+   const char typed[] = "3*4+1";
+   evaluations = graphGetEvaluations();
+   simBeginCall("command line under the graph (row typed)");
+   beginDirectMode();
+   writeDisplayMemory(screenGetAddress() + (2 * FRAME_BYTES_PER_ROW), (const unsigned char *) typed, sizeof(typed) - 1);
+   endDirectMode();
+   graphShowText(screenGetAddress() + FRAME_BYTES_PER_ROW);
+   flushDisplayQueue();
+   simEndCall();
+   printf("   evaluations: %lu, command line at %u\n", graphGetEvaluations() - evaluations, simGetScreenBlockAddress(3));
+   CHECK((graphGetEvaluations() == evaluations) && (simGetScreenBlockAddress(3) == (screenGetAddress() + FRAME_BYTES_PER_ROW)));
+   graphSetSplit('0');
+   measureGraph("drawGraph (split screen off)", equationSlots, windowBounds);
+   printf("   graph lines %d\n", simGetState()->scroll[2] + 1);
+   CHECK((simGetState()->scroll[2] + 1) == FRAME_HEIGHT);
+   // the other text modes share the pages the command line leaves: going from one to another
+   // repaints it (the page clear stands in for the screen routine), going back to 'c' does not
+   const char sharedModes[] = { 'e', 'q', 'm', 'f', 'e' };
+   const char *sharedCalls[] = { "showScreen 'e' (shared page)", "showScreen 'q' (shared page)",
+                                 "showScreen 'm' (shared page)", "showScreen 'f' (shared page)",
+                                 "showScreen 'e' (shared page, again)" };
+   unsigned long repaintBytes = 0;
+   for (i = 0; i < (sizeof(sharedModes) / sizeof(sharedModes[0])); i++) {
+      simBeginCall(sharedCalls[i]);
+      current = showScreen(sharedModes[i], '0');
+      if (current == '0') {
+         beginDirectMode();
+         fillDisplayMemory(screenGetAddress(), ' ', FRAME_TEXT_LAYER_BYTES);
+         endDirectMode();
+      }
+      flushDisplayQueue();
+      SimCounters shared = simEndCall();
+      repaintBytes += shared.dataBytes;
+      printf("   resident: %c, text page at %u\n", current, screenGetAddress());
+      CHECK(current == '0');   // one page to share with FRAME_TEXT_PAGES 2
+   }
+   printf("   repainted: %lu data bytes over %u switches\n", repaintBytes,
+          (unsigned int) (sizeof(sharedModes) / sizeof(sharedModes[0])));
+   simBeginCall("showScreen 'c' (back from a shared page)");
+   current = showScreen('c', '0');
+   flushDisplayQueue();
+   SimCounters back = simEndCall();
+   printf("   resident: %c, text page at %u\n", current, simGetScreenBlockAddress(1));
+   CHECK((current == '1') && (simGetScreenBlockAddress(1) == 0) && (back.dataBytes < 16));
+   // keypad ring: a burst of keys longer than the ring, then the main loop's drain
+   unsigned char key;
+   unsigned int keys = 0;
+   initKeypadQueue();
+   simBeginCall("keypad queue (40 keys in)");
+   for (i = 0; i < 40; i++) {
+      keypadEnqueue((unsigned char) (1 + (i % 20)));
+   }
+   simEndCall();
+   simBeginCall("keypad queue (drain)");
+   while (keypadDequeue(&key) == '1') {
+      keys++;
+   }
+   simEndCall();
+   printf("   keys taken: %u, dropped while full: %u\n", keys, keypadGetDropped());
+   CHECK((keys == (KEYPAD_QUEUE_SIZE - 1)) && (keypadGetDropped() == (40 - keys)));
+   // keypad scan: a bouncing press and release, a held cursor key, two overlapping keys
+   initKeypadQueue();
+   initKeypad(1UL << 3);   // raw key 3 repeats
+   keypadScanTick = 0;
+   keypadFirstKeyTick = -1;
+   feedKeypad(7, 1);
+   feedKeypad(0, 1);
+   feedKeypad(7, 40);
+   feedKeypad(0, 1);
+   feedKeypad(7, 1);
+   feedKeypad(0, 5);
+   keys = drainKeypad();
+   printf("keypad scan (bouncing press)  key queued at tick %d, keys %u, state '%c'\n",
+          keypadFirstKeyTick, keys, keypadGetState());
+   CHECK((keys == 1) && (keypadFirstKeyTick == (2 + KEYPAD_DEBOUNCE_TICKS)));
+   feedKeypad(3, 1000);
+   feedKeypad(0, 5);
+   keys = drainKeypad();
+   printf("keypad scan (cursor held 1 s)  keys %u\n", keys);
+   // the press, the first repeat after the delay and one more every interval
+   CHECK(keys == (2 + ((1000 - KEYPAD_DEBOUNCE_TICKS - KEYPAD_REPEAT_DELAY_TICKS) / KEYPAD_REPEAT_INTERVAL_TICKS)));
+   feedKeypad(4, 20);
+   feedKeypad(5, 20);
+   feedKeypad(0, 5);
+   keys = drainKeypad();
+   printf("keypad scan (4 then 5 before 4 is released)  keys %u, state '%c'\n", keys, keypadGetState());
+   CHECK(keys == 2);
+   // key-to-pixel latency: keys handled the way the main loop does; a key is timed by the first
+   // latencyPoll() that finds the display queue drained (the flush stands in for the passes that
+   // find it busy)
+   initLatency();
+   initKeypadQueue();
+   for (i = 0; i < 8; i++) {
+      keypadEnqueue(1);
+      keypadDequeue(&key);
+      writeDisplayMemory(screenGetAddress() + i, (const unsigned char *) "x", 1);
+      latencyKeyHandled('p', keypadGetStamp());
+      latencyPoll();
+      CHECK(latencyGetStats('p')->count == i);   // its byte is still queued
+      flushDisplayQueue();
+      latencyPoll();
+   }
+   CHECK(latencyGetStats('p')->count == 8);
+   keypadEnqueue(2);
+   keypadDequeue(&key);
+   showScreen('c', '0');
+   latencyKeyHandled('t', keypadGetStamp());
+   flushDisplayQueue();
+   latencyPoll();
+   keypadEnqueue(2);
+   keypadDequeue(&key);
+   graphInvalidateAll();
+   drawGraph(equationSlots, windowBounds);
+   latencyKeyHandled('t', keypadGetStamp());
+   flushDisplayQueue();
+   latencyPoll();
+   CHECK(latencyGetStats('t')->count == 2);
+   diagnosticsPrint();
+   // every byte the model saw is charged to exactly one operation
+   SimCounters model = simGetTotals();
+   unsigned long profiledCommands = 0;
+   unsigned long profiledData = 0;
+   unsigned long profiledCsrw = 0;
+   unsigned char operation;
+   for (operation = 0; operation < BUS_OPERATIONS; operation++) {
+      const BusProfile *profile = busProfileGet(operation);
+      profiledCommands += profile->commandBytes;
+      profiledData += (profile->parameterBytes + profile->payloadBytes);
+      profiledCsrw += profile->csrwSequences;
+   }
+   printf("bus profile: cmd %lu data %lu csrw %lu, model: cmd %lu data %lu csrw %lu\n",
+          profiledCommands, profiledData, profiledCsrw, model.commandBytes, model.dataBytes, model.csrwCommands);
+   CHECK((profiledCommands == model.commandBytes) && (profiledData == model.dataBytes) && (profiledCsrw == model.csrwCommands));
+   // gap buffer: typing at the end redraws one character, an edit in the middle the rest of the line
+   char editorStorage[120];
+   TextEditor editor;
+   int first;
+   int last;
+   editorInit(&editor, editorStorage, sizeof(editorStorage));
+   simBeginCall("editor (type 40 characters)");
+   for (i = 0; i < 40; i++) {
+      editorInsert(&editor, (char) ('a' + (i % 26)));
+      editorTakeChange(&editor, &first, &last);
+   }
+   simEndCall();
+   printf("   last keystroke changed positions %d..%d\n", first, last);
+   CHECK((first == 39) && (last == 39));
+   editorSetCursor(&editor, 10);
+   simBeginCall("editor (insert at 10 of 40)");
+   editorInsert(&editor, '+');
+   simEndCall();
+   editorTakeChange(&editor, &first, &last);
+   printf("   changed positions %d..%d\n", first, last);
+   CHECK((first == 10) && (last == 40));
+   simBeginCall("editor (insert after it)");
+   editorInsert(&editor, '-');
+   simEndCall();
+   simBeginCall("editor (delete at 11)");
+   editorDelete(&editor);
+   simEndCall();
+   editorTakeChange(&editor, &first, &last);
+   printf("   changed positions %d..%d, text \"%s\"\n", first, last, editorText(&editor));
+   CHECK((first == 11) && (last == 41));
+   CHECK(strcmp(editorText(&editor), "abcdefghij+-lmnopqrstuvwxyzabcdefghijklmn") == 0);
+   // a short command sequence returns as soon as it is queued; the drain happens under the ISR
+   simBeginCall("systemSet (queue only)");
+   systemSet();
+   simEndCall();
+   CHECK(displayQueueEmpty() == '0');
+   simBeginCall("systemSet (drain)");
+   flushDisplayQueue();
+   simEndCall();
+   CHECK(displayQueueEmpty() == '1');
+   printf("\n");
+   simPrintCommandTable();
+   printf("\nchecks failed: %d\n", checkFailures);
+   return ((checkFailures == 0) ? 0 : 1);
+}
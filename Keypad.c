@@ -0,0 +1,83 @@
+#include "DisplayHAL.h"
+#include "KeypadQueue.h"
+#include "Keypad.h"
+
+char keypadState = 'i';              // see [Keypad Scanning] in Keypad.h
+unsigned char keypadKey;             // key being pressed or held (0 while settling to idle)
+unsigned int keypadTicks;            // ticks the reading has been stable, or left until the next repeat
+unsigned long keypadRepeatKeys;      // bit n set: raw key n repeats while held
+
+// repeatKeys: bit n set for each raw key n that auto-repeats (the cursor keys)
+void initKeypad(unsigned long repeatKeys)
+{
+   keypadState = 'i';
+   keypadKey = 0;
+   keypadTicks = 0;
+   keypadRepeatKeys = repeatKeys;
+}
+
+static void startPress(unsigned char rawKey)
+{
+   keypadState = 'd';
+   keypadKey = rawKey;
+   keypadTicks = 1;
+}
+
+// one scan tick with the current keypad reading; '1' while the tick has to keep running, '0' once
+// the keypad is idle again (the caller stops the tick and re-enables the pin-change wakeup)
+char keypadTick(unsigned char rawKey)
+{
+   HAL_CYCLES(24);   // call/return, state dispatch, compare and counter update
+   if (rawKey > KEYPAD_KEYS) {
+      rawKey = 0;
+   }
+   switch (keypadState) {
+      case 'i':
+         if (rawKey == 0) {
+            return '0';
+         }
+         startPress(rawKey);
+         break;
+      case 'd':
+         if (rawKey != keypadKey) {
+            startPress(rawKey);   // still bouncing: start over with what is read now
+         } else if (++keypadTicks >= KEYPAD_DEBOUNCE_TICKS) {
+            if (keypadKey == 0) {
+               keypadState = 'i';
+               return '0';
+            }
+            keypadEnqueue(keypadKey);
+            keypadState = 'h';
+            keypadTicks = KEYPAD_REPEAT_DELAY_TICKS;
+         }
+         break;
+      case 'h':
+         if ((rawKey != 0) && (rawKey != keypadKey)) {
+            startPress(rawKey);   // the next key went down before this one was released
+         } else if (rawKey == 0) {
+            keypadState = 'u';
+            keypadTicks = 1;
+         } else if (((keypadRepeatKeys & (1UL << keypadKey)) != 0) && (--keypadTicks == 0)) {
+            keypadEnqueue(keypadKey);
+            keypadTicks = KEYPAD_REPEAT_INTERVAL_TICKS;
+         }
+         break;
+      case 'u':
+         if (rawKey == keypadKey) {
+            keypadState = 'h';   // a bounce of the held key, not a second press
+            keypadTicks = KEYPAD_REPEAT_DELAY_TICKS;
+         } else if (rawKey != 0) {
+            startPress(rawKey);
+         } else if (++keypadTicks >= KEYPAD_DEBOUNCE_TICKS) {
+            keypadState = 'i';
+            return '0';
+         }
+         break;
+   }
+   return '1';
+}
+
+char keypadGetState()
+{
+   return keypadState;
+}
@@ -0,0 +1,29 @@
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+// [Keypad Scanning]
+//    Keys are no longer polled every 80 ms. A pin change on the keypad lines wakes a 1 ms scan
+//    tick (Timer1), which runs only while a key is down or settling. The pin-change interrupt stays
+//    off while the tick runs. keypadTick() steps one key through a short debounce state machine:
+//    > 'i' idle: nothing pressed, the tick is stopped
+//    > 'd' press: the reading has to stay the same for KEYPAD_DEBOUNCE_TICKS before the key counts,
+//      so a key is queued about 3 ms after it goes down
+//    > 'h' held: keys in the repeat set are queued again after KEYPAD_REPEAT_DELAY_TICKS, then every
+//      KEYPAD_REPEAT_INTERVAL_TICKS
+//    > 'u' release: a bounce back to the held key returns to 'h' without a second key. A different
+//      key starts its own press right away, so fast typing with overlapping keys is not dropped.
+//      KEYPAD_DEBOUNCE_TICKS of no key return to idle.
+//    Pressing the same key twice queues it twice; only a bounce inside a press is filtered out.
+//    keypadTick() runs in the keypad ISR and is the keypad queue's only producer.
+
+#define KEYPAD_KEYS 20                      // raw key codes 1..20, 0 = no key
+#define KEYPAD_TICK_US 1000                 // scan tick period while a key is active
+#define KEYPAD_DEBOUNCE_TICKS 3             // stable readings before a press or release counts
+#define KEYPAD_REPEAT_DELAY_TICKS 500       // hold time before a repeat key repeats
+#define KEYPAD_REPEAT_INTERVAL_TICKS 80     // time between repeats
+
+void initKeypad(unsigned long repeatKeys);
+char keypadTick(unsigned char rawKey);
+char keypadGetState();
+
+#endif
@@ -0,0 +1,77 @@
+#include "DisplayHAL.h"
+#include "KeypadQueue.h"
+#include "Latency.h"
+
+#define KEYPAD_QUEUE_MASK (KEYPAD_QUEUE_SIZE - 1)
+
+// key ring: the keypad ISR only moves the tail, the main loop only moves the head
+volatile unsigned char keypadQueueKeys[KEYPAD_QUEUE_SIZE];
+volatile unsigned char keypadQueueHead;       // next key the main loop will take
+volatile unsigned char keypadQueueTail;       // next free entry
+volatile unsigned int keypadDropped;          // keys that arrived while the ring was full
+#ifdef LATENCY_TIMING
+volatile unsigned int keypadQueueStamps[KEYPAD_QUEUE_SIZE];   // latencyStamp() when each key was queued
+unsigned int keypadTakenStamp;                // stamp of the key keypadDequeue() returned last
+#endif
+
+void initKeypadQueue(void)
+{
+   keypadQueueHead = 0;
+   keypadQueueTail = 0;
+   keypadDropped = 0;
+}
+
+// called from the keypad ISR only; '0' if the ring was full and the key was dropped
+char keypadEnqueue(unsigned char key)
+{
+   HAL_CYCLES(16);   // call/return, full test, indexed store, tail store
+   unsigned char tail = keypadQueueTail;
+   unsigned char nextTail = ((tail + 1) & KEYPAD_QUEUE_MASK);
+   if (nextTail == keypadQueueHead) {
+      keypadDropped++;
+      return '0';
+   }
+   keypadQueueKeys[tail] = key;
+#ifdef LATENCY_TIMING
+   keypadQueueStamps[tail] = latencyStamp();
+#endif
+   keypadQueueTail = nextTail;   // publish the key only once it is stored
+   return '1';
+}
+
+// called from the main loop only; '1' with the oldest key in *key, '0' if the ring is empty
+char keypadDequeue(unsigned char *key)
+{
+   HAL_CYCLES(16);   // call/return, empty test, indexed load, head store
+   unsigned char head = keypadQueueHead;
+   if (head == keypadQueueTail) {
+      return '0';
+   }
+   *key = keypadQueueKeys[head];
+#ifdef LATENCY_TIMING
+   keypadTakenStamp = keypadQueueStamps[head];
+#endif
+   keypadQueueHead = ((head + 1) & KEYPAD_QUEUE_MASK);   // the slot is free once the key is read
+   return '1';
+}
+
+char keypadQueueEmpty()
+{
+   if (keypadQueueHead == keypadQueueTail) {
+      return '1';
+   }
+   return '0';
+}
+
+#ifdef LATENCY_TIMING
+// when the key keypadDequeue() returned last was queued, a latencyStamp() (see Latency.h)
+unsigned int keypadGetStamp()
+{
+   return keypadTakenStamp;
+}
+#endif
+
+unsigned int keypadGetDropped()
+{
+   return keypadDropped;
+}
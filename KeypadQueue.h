@@ -0,0 +1,34 @@
+#ifndef KEYPAD_QUEUE_H
+#define KEYPAD_QUEUE_H
+
+// [Keypad Queue]
+//    Single-producer/single-consumer ring between the keypad interrupt and the main loop, the
+//    same scheme as the display transmit ring (DisplayBus.c): the ISR only moves the tail, the main
+//    loop only moves the head, both indices are single bytes (read and written atomically on the
+//    AVR) and a slot is published by storing the index after the slot itself. Neither side
+//    disables interrupts or waits for the other, so the nested sei() in ISR(TIMER1_COMPA_vect)
+//    is harmless: Timer0 never touches the ring, and the keypad ISR runs far shorter than its
+//    period, so it never interrupts itself. Enqueue and dequeue are O(1).
+//    When the ring is full the new key is dropped and counted (keypadGetDropped); the producer
+//    may not move the head to make room, that index belongs to the consumer.
+//    Each key is stored with the time it was queued (a 16-bit latencyStamp), read back with
+//    keypadGetStamp() after keypadDequeue() to time the key until its pixels are on the display
+//    (builds with LATENCY_TIMING only; without it there are no stamps and keypadGetStamp() is 0).
+
+#define KEYPAD_QUEUE_SIZE 32    // keys in the ring (power of two, fits an 8-bit index)
+
+void initKeypadQueue(void);
+char keypadEnqueue(unsigned char key);
+char keypadDequeue(unsigned char *key);
+char keypadQueueEmpty();
+unsigned int keypadGetDropped();
+#ifdef LATENCY_TIMING
+   unsigned int keypadGetStamp();
+#else
+   static inline unsigned int keypadGetStamp()
+   {
+      return 0;
+   }
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+#include <stddef.h>
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Latency.h"
+
+#ifdef LATENCY_TIMING
+
+LatencyStats latencyStats[LATENCY_TYPE_COUNT];
+volatile unsigned int latencyOverflows;   // Timer1 overflows (upper 16 bits of the count)
+char latencyPendingTypes[LATENCY_PENDING];          // keys handled, pixels not on the display yet
+unsigned int latencyPendingStamps[LATENCY_PENDING];
+unsigned char latencyPendingCount;
+
+void initLatency(void)
+{
+   int type;
+   int bucket;
+   latencyPendingCount = 0;
+   for (type = 0; type < LATENCY_TYPE_COUNT; type++) {
+      latencyStats[type].count = 0;
+      latencyStats[type].minUs = 0;
+      latencyStats[type].maxUs = 0;
+      for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+         latencyStats[type].buckets[bucket] = 0;
+      }
+   }
+}
+
+// microseconds since start-up (wraps after about 71 minutes; differences stay correct)
+unsigned long latencyNow(void)
+{
+   HAL_CYCLES(20);   // call/return, timer read with interrupts held off, scaling
+#ifdef HOST_BUILD
+   return (unsigned long) (simGetTotals().cpuCycles / (F_CPU / 1000000UL));
+#else
+   unsigned char sreg = SREG;
+   cli();
+   unsigned int count = TCNT1;
+   unsigned long overflows = latencyOverflows;
+   if (((TIFR1 & (1 << TOV1)) != 0) && (count < 0x8000)) {
+      overflows++;   // wrapped after cli(), the overflow ISR has not run yet
+   }
+   SREG = sreg;
+   return (((overflows << 16) | count) * (LATENCY_TIMER_PRESCALER / (F_CPU / 1000000UL)));   // 4 us per count
+#endif
+}
+
+// latencyNow() in LATENCY_STAMP_US units, cut to 16 bits (a key stamp)
+unsigned int latencyStamp(void)
+{
+   return (unsigned int) (latencyNow() / LATENCY_STAMP_US);
+}
+
+// the latencyNow() time of a stamp taken less than 65536 units ago (within half a unit)
+static unsigned long stampToUs(unsigned int stamp)
+{
+   unsigned long now = (latencyNow() / LATENCY_STAMP_US);
+   unsigned int elapsed = (unsigned int) ((unsigned int) now - stamp);
+   return (((now - elapsed) * LATENCY_STAMP_US) + (LATENCY_STAMP_US / 2));   // the middle of the unit
+}
+
+// called from ISR(TIMER1_OVF_vect) only
+void latencyClockOverflow(void)
+{
+   latencyOverflows++;
+}
+
+static int typeIndex(char inputType)
+{
+   int type;
+   for (type = 0; type < LATENCY_TYPE_COUNT; type++) {
+      if (LATENCY_TYPES[type] == inputType) {
+         return type;
+      }
+   }
+   return -1;
+}
+
+// the key of type inputType stamped stampUs by latencyNow() is on screen now
+void latencyRecord(char inputType, unsigned long stampUs)
+{
+   int type = typeIndex(inputType);
+   if (type < 0) {
+      return;
+   }
+   LatencyStats *stats = &latencyStats[type];
+   unsigned long us = (latencyNow() - stampUs);
+   unsigned long ms = (us / 1000);
+   int bucket = 0;
+   if (ms > 0) {
+      bucket = 1;
+      while (((ms >> bucket) != 0) && (bucket < (LATENCY_BUCKETS - 1))) {
+         bucket++;
+      }
+   }
+   if ((stats->count == 0) || (us < stats->minUs)) {
+      stats->minUs = us;
+   }
+   if (us > stats->maxUs) {
+      stats->maxUs = us;
+   }
+   if (stats->count < 0xFFFF) {
+      stats->count++;
+      stats->buckets[bucket]++;
+   }
+}
+
+// the main loop has handled the key of type inputType stamped stamp; latencyPoll() times it once
+// its pixels are on the display. Not timed if LATENCY_PENDING keys are waiting already.
+void latencyKeyHandled(char inputType, unsigned int stamp)
+{
+   HAL_CYCLES(8);
+   if ((typeIndex(inputType) < 0) || (latencyPendingCount >= LATENCY_PENDING)) {
+      return;
+   }
+   latencyPendingTypes[latencyPendingCount] = inputType;
+   latencyPendingStamps[latencyPendingCount] = stamp;
+   latencyPendingCount++;
+}
+
+// times every handled key if the display queue has drained since; never waits for it
+void latencyPoll(void)
+{
+   unsigned char i;
+   HAL_CYCLES(4);
+   if ((latencyPendingCount == 0) || (displayQueueEmpty() == '0')) {
+      return;
+   }
+   for (i = 0; i < latencyPendingCount; i++) {
+      latencyRecord(latencyPendingTypes[i], stampToUs(latencyPendingStamps[i]));
+   }
+   latencyPendingCount = 0;
+}
+
+// NULL for an input type that is not timed
+const LatencyStats *latencyGetStats(char inputType)
+{
+   int type = typeIndex(inputType);
+   if (type < 0) {
+      return NULL;
+   }
+   return &latencyStats[type];
+}
+
+#endif
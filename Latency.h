@@ -0,0 +1,66 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+// [Key-to-Pixel Latency]
+//    keypadEnqueue() stamps every key with latencyStamp(), 16 bits in LATENCY_STAMP_US units, so
+//    a stamp wraps after about 4.2 s; a key must be timed within that. When the main loop has
+//    handled a key it passes the key's input type (see getInputType) and stamp to
+//    latencyKeyHandled() and goes on; nothing waits for the display. latencyPoll(), called from
+//    every pass of the main loop, times the handled keys once displayQueueEmpty() is true, which
+//    is when their pixels are out (up to LATENCY_PENDING keys at a time, further ones are not
+//    timed). The time is kept per input type: count, minimum, maximum and a histogram with
+//    power-of-two bounds in ms. This is the figure optimizations are judged by.
+//    The hidden diagnostics screen shows it (see Diagnostics.h), and the host build prints it with
+//    diagnosticsPrint().
+//    > board: Timer1 counts freely at F_CPU / 64 (4 us); ISR(TIMER1_OVF_vect) calls
+//      latencyClockOverflow() to extend the count past 16 bits
+//    > host build: the simulated CPU cycle count, so every HAL_CYCLES charge and bus wait is included
+//    The statistics, the pending keys and the keypad queue's stamps take about 260 bytes of SRAM,
+//    so timing is only built with -DLATENCY_TIMING (the host harness turns it on). Without it the
+//    calls the main loop and the keypad queue make are empty and every stamp is 0.
+
+#define LATENCY_TYPES "patecd"         // input types timed, in display order
+#define LATENCY_TYPE_COUNT 6
+#define LATENCY_BUCKETS 10             // <1, <2, <4 ... <256 ms, then 256 ms and more
+#define LATENCY_TIMER_PRESCALER 64     // Timer1 clock select (CS11 | CS10)
+#define LATENCY_STAMP_US 64            // unit of the 16-bit key stamps
+#define LATENCY_PENDING 4              // keys handled and waiting for the display queue to drain
+
+typedef struct {
+   unsigned int count;
+   unsigned long minUs;
+   unsigned long maxUs;
+   unsigned int buckets[LATENCY_BUCKETS];
+} LatencyStats;
+
+#ifdef LATENCY_TIMING
+   void initLatency(void);
+   unsigned long latencyNow(void);
+   void latencyClockOverflow(void);
+   unsigned int latencyStamp(void);
+   void latencyRecord(char inputType, unsigned long stampUs);
+   void latencyKeyHandled(char inputType, unsigned int stamp);
+   void latencyPoll(void);
+   const LatencyStats *latencyGetStats(char inputType);
+#else
+   static inline void initLatency(void)
+   {
+   }
+
+   static inline unsigned int latencyStamp(void)
+   {
+      return 0;
+   }
+
+   static inline void latencyKeyHandled(char inputType, unsigned int stamp)
+   {
+      (void) inputType;
+      (void) stamp;
+   }
+
+   static inline void latencyPoll(void)
+   {
+   }
+#endif
+
+#endif
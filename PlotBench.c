@@ -0,0 +1,125 @@
+#include <stdio.h>
+#define HOST_PROGRAM
+#include "DisplayHAL.h"
+#include "SED1335Sim.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+
+// [Plot Pipeline Benchmark]
+//    Draws each demo curve twice on the host model: once with the floating-point column loop the
+//    demo used before the Q16.16 pipeline (kept here as the reference, annotated with the cost of
+//    the soft-float routines it compiles to) and once with the demo's fixed-point routines. Both
+//    render through the same endPlot(), so the difference per frame is the sampling arithmetic.
+//    The traces are compared column by column to show what the fixed-point rounding changes. Each
+//    curve is drawn once with the fixed-point routine before measuring, so both frames replace
+//    an almost identical trace and move the same few bus bytes; the ratio is the sampling cost.
+//    The one column posLine and negLine move is x = -0.25, where the reference's double arithmetic
+//    gives (10.25 / 20) * 240 = 122.99999 and truncates to row 122; Q16.16 holds every step of
+//    that window exactly and lands on row 123, the true value. The reference is the one that is off.
+
+#define BENCH_X_MIN -10.0
+#define BENCH_X_MAX 10.0
+#define BENCH_Y_MIN -10.0
+#define BENCH_Y_MAX 10.0
+
+// firmware entry points and state (DisplayDemoGraphicsOnly.c)
+int firmwareMain(void);
+int drawPosLine();
+int drawNegLine();
+int drawParabola();
+int drawPoint(int scaledX, int scaledY);
+int beginPlot();
+int endPlot();
+extern unsigned char plotRows[FRAME_WIDTH];
+
+static unsigned char referenceRows[FRAME_WIDTH];
+
+static double curvePosLine(double x)
+{
+   return x;
+}
+
+static double curveNegLine(double x)
+{
+   HAL_CYCLES(CYCLES_FLOAT_MUL);
+   return (-1.0 * x);
+}
+
+static double curveParabola(double x)
+{
+   HAL_CYCLES(CYCLES_FLOAT_MUL);
+   return (x * x);
+}
+
+// the pre-Q16.16 loop: every column costs a float subtract, two compares, two divides, two
+// multiplies, two conversions to int and a float add, on top of the curve itself
+static void drawReference(double (*curve)(double))
+{
+   beginPlot();
+   double xStepSize = ((BENCH_X_MAX - BENCH_X_MIN) / FRAME_WIDTH);
+   double x = BENCH_X_MIN;
+   while (x < BENCH_X_MAX) {
+      HAL_CYCLES(CYCLES_FLOAT_CMP);
+      double y = curve(x);
+      double invertedY = (BENCH_Y_MAX - y);
+      HAL_CYCLES(CYCLES_FLOAT_ADD + (2 * CYCLES_FLOAT_CMP));
+      if ((invertedY >= 0) && (invertedY < (BENCH_Y_MAX - BENCH_Y_MIN))) {
+         int scaledY = ((int) ((invertedY / (BENCH_Y_MAX - BENCH_Y_MIN)) * FRAME_HEIGHT));
+         int scaledX = ((int) (((x - BENCH_X_MIN) / (BENCH_X_MAX - BENCH_X_MIN)) * FRAME_WIDTH));
+         HAL_CYCLES(CYCLES_FLOAT_ADD + (2 * CYCLES_FLOAT_DIV) + (2 * CYCLES_FLOAT_MUL) + (2 * CYCLES_FLOAT_TO_INT));
+         drawPoint(scaledX, scaledY);
+      } else {
+         int scaledX = ((int) (((x - BENCH_X_MIN) / (BENCH_X_MAX - BENCH_X_MIN)) * FRAME_WIDTH));
+         HAL_CYCLES(CYCLES_FLOAT_ADD + CYCLES_FLOAT_DIV + CYCLES_FLOAT_MUL + CYCLES_FLOAT_TO_INT + CYCLES_FLOAT_CMP);
+         drawPoint(scaledX, ((invertedY < 0) ? FRAME_ROW_ABOVE : FRAME_ROW_BELOW));
+      }
+      x += xStepSize;
+      HAL_CYCLES(CYCLES_FLOAT_ADD);
+   }
+   int i;
+   for (i = 0; i < FRAME_WIDTH; i++) {
+      referenceRows[i] = plotRows[i];
+   }
+   endPlot();
+}
+
+static int countDifferentColumns(void)
+{
+   int differences = 0;
+   int i;
+   for (i = 0; i < FRAME_WIDTH; i++) {
+      if (referenceRows[i] != plotRows[i]) {
+         differences++;
+      }
+   }
+   return differences;
+}
+
+static void compareCurve(const char *name, double (*curve)(double), int (*drawFixed)())
+{
+   char label[SIM_CALL_NAME_SIZE];
+   drawFixed();   // the curve both measured frames replace
+   snprintf(label, sizeof(label), "%s (double)", name);
+   simBeginCall(label);
+   drawReference(curve);
+   SimCounters reference = simEndCall();
+   snprintf(label, sizeof(label), "%s (Q16.16)", name);
+   simBeginCall(label);
+   drawFixed();
+   SimCounters fixed = simEndCall();
+   printf("   %-12s  %8llu -> %8llu cycles/frame (%.2fx)  columns that moved: %d\n", name,
+          reference.cpuCycles, fixed.cpuCycles, ((double) reference.cpuCycles) / fixed.cpuCycles,
+          countDifferentColumns());
+}
+
+int main(void)
+{
+   simReset();
+   firmwareMain();
+   compareCurve("posLine", curvePosLine, drawPosLine);
+   compareCurve("negLine", curveNegLine, drawNegLine);
+   compareCurve("parabola", curveParabola, drawParabola);
+   printf("\n");
+   return 0;
+}
@@ -0,0 +1,65 @@
+#include <math.h>
+#include "DisplayHAL.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+
+// nearest Q16.16 value (doubleToFixed() truncates, which would make a step like 0.1 fall short
+// by up to one unit per column and drift a whole column over a wide screen)
+static fixed_t roundToFixed(double value)
+{
+   return doubleToFixed(value + ((value < 0) ? (-0.5 / FIXED_ONE) : (0.5 / FIXED_ONE)));
+}
+
+// '1' if value is representable in Q16.16 without saturating ('0' for NaN as well)
+static char fixedRange(double value)
+{
+   return (((value > -32767.0) && (value < 32767.0)) ? '1' : '0');
+}
+
+// the only floating-point work of a plot, done once per change of window bounds. Returns -1 and
+// leaves window untouched if the bounds are empty, reversed, NaN or outside the Q16.16 range
+// (including their spans), or if the screen has no columns or rows.
+int plotWindowInit(PlotWindow *window, double xMin, double xMax, double yMin, double yMax,
+                   int screenWidth, int screenHeight)
+{
+   if (!(xMax > xMin) || !(yMax > yMin) || (screenWidth <= 0) || (screenHeight <= 0)
+       || (fixedRange(xMin) == '0') || (fixedRange(xMax) == '0') || (fixedRange(xMax - xMin) == '0')
+       || (fixedRange(yMin) == '0') || (fixedRange(yMax) == '0') || (fixedRange(yMax - yMin) == '0')
+       || (fixedRange(screenHeight / (yMax - yMin)) == '0')) {
+      return -1;
+   }
+   window->xStart = roundToFixed(xMin);
+   window->xStep = roundToFixed((xMax - xMin) / screenWidth);
+   window->yTop = roundToFixed(yMax);
+   window->yRange = roundToFixed(yMax - yMin);
+   window->rowScale = roundToFixed(screenHeight / (yMax - yMin));
+   window->screenRows = screenHeight;
+   return 0;
+}
+
+// screen row (0 = top) of y, or FRAME_ROW_ABOVE/FRAME_ROW_BELOW if y is outside the window
+unsigned char plotRowForY(const PlotWindow *window, fixed_t y)
+{
+   HAL_CYCLES(4 * CYCLES_LONG_OP);
+   if (y > window->yTop) {
+      return FRAME_ROW_ABOVE;
+   } else if (y <= (window->yTop - window->yRange)) {   // yMin, in range since plotWindowInit() checked it
+      return FRAME_ROW_BELOW;
+   }
+   fixed_t below = (window->yTop - y);   // 0 <= below < yRange, cannot overflow
+   int32_t row = (fixedMul(below, window->rowScale) >> FIXED_SHIFT);
+   if (row >= window->screenRows) {
+      row = (window->screenRows - 1);
+   }
+   return (unsigned char) row;
+}
+
+// for results that had to be computed in floating point; FRAME_NO_ROW for NaN or +-infinity
+unsigned char plotRowForValue(const PlotWindow *window, double y)
+{
+   HAL_CYCLES(CYCLES_FLOAT_MUL + CYCLES_FLOAT_TO_INT + (3 * CYCLES_FLOAT_CMP));
+   if (!isfinite(y)) {
+      return FRAME_NO_ROW;
+   }
+   return plotRowForY(window, doubleToFixed(y));
+}
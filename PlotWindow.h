@@ -0,0 +1,85 @@
+#ifndef PLOT_WINDOW_H
+#define PLOT_WINDOW_H
+
+#include <stdint.h>
+
+// [Fixed-Point Plotting]
+//    Window bounds are converted to Q16.16 once (plotWindowInit), after which the per-column work
+//    of a plot is integer only: x advances by a precomputed step and y maps to a screen row with
+//    two compares, two subtractions and one widening multiply. Floating point is only needed when an
+//    expression itself has to be evaluated in float; plotRowForValue() converts its result once.
+//    plotWindowInit() rounds the bounds to the nearest Q16.16 value and fails (-1) for a window it
+//    cannot map: empty or reversed bounds, or bounds or spans past +-32767.
+//    Include DisplayHAL.h before this header (fixedMul charges the host cycle model).
+
+typedef int32_t fixed_t;   // Q16.16, range +-32767 (32 bits on the host too, so it overflows the same)
+
+#define FIXED_SHIFT 16
+#define FIXED_ONE ((fixed_t) 1 << FIXED_SHIFT)
+#define FIXED_MAX INT32_MAX
+#define FIXED_MIN INT32_MIN
+
+// [AVR Arithmetic Cost Model]
+//    Approximate cycles of the avr-libc/libgcc routines each operation compiles to, used by
+//    HAL_CYCLES annotations so plotting loops can be compared on the host model.
+   #define CYCLES_FLOAT_ADD 100      // __addsf3 / __subsf3
+   #define CYCLES_FLOAT_MUL 150      // __mulsf3
+   #define CYCLES_FLOAT_DIV 480      // __divsf3
+   #define CYCLES_FLOAT_CMP 50       // __cmpsf2 and friends
+   #define CYCLES_FLOAT_TO_INT 70    // __fixsfsi
+   #define CYCLES_INT_TO_FLOAT 80    // __floatsisf
+   #define CYCLES_FIXED_MUL 90       // __mulsidi3 (32x32 -> 64 with MUL) plus the 16-bit shift
+   #define CYCLES_LONG_OP 4          // 32-bit add, subtract or compare
+   #define CYCLES_FLOAT_SQRT 500     // sqrt
+   #define CYCLES_FLOAT_TRIG 1700    // sin, cos, tan, asin, acos, atan
+   #define CYCLES_FLOAT_LOG 2000     // log, log10, exp
+   #define CYCLES_FLOAT_POW 4200     // pow (log + multiply + exp)
+
+typedef struct {
+   fixed_t xStart;     // x at the left edge of column 0
+   fixed_t xStep;      // x advance per column
+   fixed_t yTop;       // y at the top edge of the window
+   fixed_t yRange;     // yMax - yMin
+   fixed_t rowScale;   // screen rows per unit of y
+   int screenRows;     // rows in the plot area
+} PlotWindow;
+
+// saturates outside +-32767; NaN gives 0 (plotRowForValue() rejects it before converting)
+static inline fixed_t doubleToFixed(double value)
+{
+   if (value != value) {
+      return 0;
+   } else if (value >= 32767.0) {
+      return FIXED_MAX;
+   } else if (value <= -32768.0) {
+      return FIXED_MIN;
+   }
+   return (fixed_t) (value * FIXED_ONE);
+}
+
+// for expressions that have to be evaluated in floating point
+static inline double fixedToDouble(fixed_t value)
+{
+   HAL_CYCLES(CYCLES_INT_TO_FLOAT + CYCLES_FLOAT_MUL);
+   return (value * (1.0 / FIXED_ONE));
+}
+
+// saturating Q16.16 product
+static inline fixed_t fixedMul(fixed_t a, fixed_t b)
+{
+   int64_t product = (((int64_t) a * b) >> FIXED_SHIFT);
+   HAL_CYCLES(CYCLES_FIXED_MUL);
+   if (product > FIXED_MAX) {
+      return FIXED_MAX;
+   } else if (product < FIXED_MIN) {
+      return FIXED_MIN;
+   }
+   return (fixed_t) product;
+}
+
+int plotWindowInit(PlotWindow *window, double xMin, double xMax, double yMin, double yMax,
+                   int screenWidth, int screenHeight);
+unsigned char plotRowForY(const PlotWindow *window, fixed_t y);
+unsigned char plotRowForValue(const PlotWindow *window, double y);
+
+#endif
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <string.h>
+#include "DisplayHAL.h"
+
+// [Pin Definitions Mirrored From The Firmware]
+   #define SIM_A0_PIN 0b00000100
+   #define SIM_DB7_PIN 0b00000010
+   #define SIM_DB6_PIN 0b00000001
+   // (DB5-DB0 correspond to Port D Pins 7-2)
+
+// [Controller Commands Decoded By The Model]
+   #define SIM_C_SYS_SET 0b01000000
+   #define SIM_C_SCROLL 0b01000100
+   #define SIM_C_CSRW 0b01000110
+   #define SIM_C_MEMWRITE 0b01000010
+   #define SIM_C_OVERLAY 0b01011011
+   #define SIM_C_HDOT_SCR 0b01011010
+   #define SIM_C_DISP_ON 0b01011001
+   #define SIM_C_DISP_OFF 0b01011000
+   #define SIM_C_CSRFORM 0b01011101
+   #define SIM_C_CSRDIR_RIGHT 0b01001100
+   #define SIM_C_CSRDIR_LEFT 0b01001101
+   #define SIM_C_CSRDIR_UP 0b01001110
+   #define SIM_C_CSRDIR_DOWN 0b01001111
+   #define SIM_C_GRAYSCALE 0b01100000
+   #define SIM_NO_COMMAND -1
+
+// simulated I/O registers
+volatile unsigned char PORTB;
+volatile unsigned char PORTD;
+volatile unsigned char PINB;
+volatile unsigned char DDRB;
+volatile unsigned char DDRD;
+volatile unsigned char TCCR0A;
+volatile unsigned char TCCR0B;
+volatile unsigned char TIMSK0;
+volatile unsigned char OCR0A;
+volatile unsigned char TCNT0;
+volatile unsigned char TCCR1B;
+volatile unsigned char TIMSK1;
+volatile unsigned int OCR1A;
+volatile unsigned int TCNT1;
+volatile unsigned char TIFR1;
+volatile unsigned char PCICR;
+volatile unsigned char PCMSK1;
+
+// per-opcode accounting
+typedef struct {
+   unsigned long invocations;
+   unsigned long dataBytes;
+} SimCommandStats;
+
+static unsigned char vram[SIM_VRAM_SIZE];
+static SimDisplayState state;
+static SimCounters totals;
+static SimCounters callStart;
+static char callName[SIM_CALL_NAME_SIZE];
+static SimCommandStats commandStats[256];
+static int currentCommand;
+static int paramIndex;
+
+// CPU/timer state
+static unsigned long long nextTimer0Cycle;
+static unsigned long long nextTimer1Cycle;
+static char timer0Armed;
+static char timer1Armed;
+static char interruptsEnabled;
+static char timer0Pending;
+static char timer1Pending;
+static char inTimer0;
+static char inTimer1;
+
+void simReset(void)
+{
+   memset(vram, 0, sizeof(vram));
+   memset(&state, 0, sizeof(state));
+   memset(&totals, 0, sizeof(totals));
+   memset(&callStart, 0, sizeof(callStart));
+   memset(commandStats, 0, sizeof(commandStats));
+   callName[0] = '\0';
+   state.displayOn = '0';
+   state.cursorStep = 1;
+   currentCommand = SIM_NO_COMMAND;
+   paramIndex = 0;
+   PORTB = 0;
+   PORTD = 0;
+   PINB = 0;
+   DDRB = 0;
+   DDRD = 0;
+   TCCR0A = 0;
+   TCCR0B = 0;
+   TIMSK0 = 0;
+   OCR0A = 0;
+   TCNT0 = 0;
+   TCCR1B = 0;
+   TIMSK1 = 0;
+   OCR1A = 0;
+   TCNT1 = 0;
+   nextTimer0Cycle = 0;
+   nextTimer1Cycle = 0;
+   timer0Armed = '0';
+   timer1Armed = '0';
+   interruptsEnabled = '0';
+   timer0Pending = '0';
+   timer1Pending = '0';
+   inTimer0 = '0';
+   inTimer1 = '0';
+}
+
+static unsigned long getPrescaler(unsigned char clockSelect)
+{
+   switch (clockSelect & 0b00000111) {
+      case 1:
+         return 1;
+      case 2:
+         return 8;
+      case 3:
+         return 64;
+      case 4:
+         return 256;
+      case 5:
+         return 1024;
+   }
+   return 0;   // timer stopped (external clock sources are not modelled)
+}
+
+// both timers run in CTC mode, so a compare match happens every (OCR + 1) * prescaler cycles
+static unsigned long long getTimer0Period(void)
+{
+   if ((TIMSK0 & (1 << OCIE0A)) == 0) {
+      return 0;
+   }
+   return ((unsigned long long) OCR0A + 1) * getPrescaler(TCCR0B);
+}
+
+static unsigned long long getTimer1Period(void)
+{
+   if ((TIMSK1 & (1 << OCIE1A)) == 0) {
+      return 0;
+   }
+   return ((unsigned long long) OCR1A + 1) * getPrescaler(TCCR1B);
+}
+
+static void runTimer0(void)
+{
+   unsigned long long startCycle = totals.cpuCycles;
+   inTimer0 = '1';
+   interruptsEnabled = '0';   // the I flag is cleared on entry and set again by RETI
+   TIMER0_COMPA_vect();
+   interruptsEnabled = '1';
+   inTimer0 = '0';
+   unsigned long isrCycles = (unsigned long) (totals.cpuCycles - startCycle);
+   totals.timer0Interrupts++;
+   totals.timer0Cycles += isrCycles;
+   if (isrCycles > totals.timer0MaxCycles) {
+      totals.timer0MaxCycles = isrCycles;
+   }
+}
+
+static void runTimer1(void)
+{
+   inTimer1 = '1';
+   interruptsEnabled = '0';
+   TIMER1_COMPA_vect();
+   interruptsEnabled = '1';
+   inTimer1 = '0';
+}
+
+// raises the compare flags of every match up to the current cycle (missed matches collapse into one flag)
+static void markDueTimers(void)
+{
+   unsigned long long period0 = getTimer0Period();
+   unsigned long long period1 = getTimer1Period();
+   if (period0 == 0) {
+      timer0Armed = '0';
+   } else {
+      if (timer0Armed == '0') {
+         nextTimer0Cycle = totals.cpuCycles + period0;
+         timer0Armed = '1';
+      }
+      while (nextTimer0Cycle <= totals.cpuCycles) {
+         timer0Pending = '1';
+         nextTimer0Cycle += period0;
+      }
+   }
+   if (period1 == 0) {
+      timer1Armed = '0';
+   } else {
+      if (timer1Armed == '0') {
+         nextTimer1Cycle = totals.cpuCycles + period1;
+         timer1Armed = '1';
+      }
+      while (nextTimer1Cycle <= totals.cpuCycles) {
+         timer1Pending = '1';
+         nextTimer1Cycle += period1;
+      }
+   }
+}
+
+// runs the highest priority pending vector (Timer0 before Timer1); returns '0' if none could run
+static char serviceOneInterrupt(void)
+{
+   if (interruptsEnabled == '0') {
+      return '0';
+   }
+   if ((timer0Pending == '1') && (inTimer0 == '0')) {
+      timer0Pending = '0';
+      runTimer0();
+      return '1';
+   }
+   if ((timer1Pending == '1') && (inTimer1 == '0')) {
+      timer1Pending = '0';
+      runTimer1();
+      return '1';
+   }
+   return '0';
+}
+
+void simSetInterrupts(char enabled)
+{
+   interruptsEnabled = enabled;
+   markDueTimers();
+   while (serviceOneInterrupt() == '1') {
+   }
+}
+
+// time spent in annotated code; inside an ISR it delays the interrupted program like on the chip
+void simChargeCycles(unsigned int cycles)
+{
+   totals.cpuCycles += cycles;
+}
+
+unsigned long simGetCpuHz(void)
+{
+   return F_CPU;
+}
+
+// the firmware's busy-wait: main-context cycles only advance while no interrupt is running
+void simDelayUs(double us)
+{
+   unsigned long long remaining = (unsigned long long) ((us * (F_CPU / 1000000UL)) + 0.5);
+   while (1) {
+      markDueTimers();
+      if (serviceOneInterrupt() == '1') {
+         if (remaining == 0) {
+            return;
+         }
+         remaining--;   // the AVR always executes one instruction of the main program after RETI
+         totals.cpuCycles++;
+         continue;
+      }
+      if (remaining == 0) {
+         return;
+      }
+      unsigned long long untilEvent = remaining;
+      if ((timer0Armed == '1') && ((nextTimer0Cycle - totals.cpuCycles) < untilEvent)) {
+         untilEvent = nextTimer0Cycle - totals.cpuCycles;
+      }
+      if ((timer1Armed == '1') && ((nextTimer1Cycle - totals.cpuCycles) < untilEvent)) {
+         untilEvent = nextTimer1Cycle - totals.cpuCycles;
+      }
+      totals.cpuCycles += untilEvent;
+      remaining -= untilEvent;
+   }
+}
+
+// firmware main loops run once on the host; the harness drives the draw routines directly
+int simKeepRunning(void)
+{
+   return 0;
+}
+
+static void decodeCommand(unsigned char command)
+{
+   totals.commandBytes++;
+   commandStats[command].invocations++;
+   currentCommand = command;
+   paramIndex = 0;
+   switch (command) {
+      case SIM_C_CSRW:
+         totals.csrwCommands++;
+         break;
+      case SIM_C_CSRDIR_RIGHT:
+         state.cursorStep = 1;
+         break;
+      case SIM_C_CSRDIR_LEFT:
+         state.cursorStep = -1;
+         break;
+      case SIM_C_CSRDIR_UP:
+         state.cursorStep = -((int) (state.sysSet[6] | (state.sysSet[7] << 8)));
+         break;
+      case SIM_C_CSRDIR_DOWN:
+         state.cursorStep = (int) (state.sysSet[6] | (state.sysSet[7] << 8));
+         break;
+   }
+}
+
+static void decodeData(unsigned char data)
+{
+   totals.dataBytes++;
+   if (currentCommand == SIM_NO_COMMAND) {
+      return;   // data with no preceding command is ignored by the controller
+   }
+   commandStats[currentCommand].dataBytes++;
+   switch (currentCommand) {
+      case SIM_C_SYS_SET:
+         if (paramIndex < 8) {
+            state.sysSet[paramIndex] = data;
+         }
+         break;
+      case SIM_C_SCROLL:
+         if (paramIndex < 10) {
+            state.scroll[paramIndex] = data;
+         }
+         break;
+      case SIM_C_CSRW:
+         if (paramIndex == 0) {
+            state.cursor = ((state.cursor & 0xFF00) | data);
+         } else if (paramIndex == 1) {
+            state.cursor = ((state.cursor & 0x00FF) | (((unsigned int) data) << 8));
+         }
+         break;
+      case SIM_C_MEMWRITE:
+         vram[state.cursor] = data;
+         state.cursor = ((unsigned int) (state.cursor + state.cursorStep)) & (SIM_VRAM_SIZE - 1);
+         totals.vramBytes++;
+         break;
+      case SIM_C_OVERLAY:
+         if (paramIndex == 0) {
+            state.overlay = data;
+         }
+         break;
+      case SIM_C_HDOT_SCR:
+         if (paramIndex == 0) {
+            state.hdotScroll = data;
+         }
+         break;
+      case SIM_C_DISP_ON:
+      case SIM_C_DISP_OFF:
+         if (paramIndex == 0) {
+            state.displayOn = (currentCommand == SIM_C_DISP_ON) ? '1' : '0';
+            state.displayAttributes = data;
+         }
+         break;
+   }
+   if (paramIndex < SIM_MAX_PARAMS) {
+      paramIndex++;
+   }
+}
+
+// called by the firmware (through HAL_BUS_STROBE) once the pins for a byte have been written
+void simBusStrobe(void)
+{
+   totals.busClocks++;   // one clock pulse per transfer
+   unsigned char byte = (unsigned char) ((PORTD >> 2) & 0b00111111);
+   if ((PORTB & SIM_DB7_PIN) == SIM_DB7_PIN) {
+      byte |= 0b10000000;
+   }
+   if ((PORTB & SIM_DB6_PIN) == SIM_DB6_PIN) {
+      byte |= 0b01000000;
+   }
+   if ((PORTB & SIM_A0_PIN) == SIM_A0_PIN) {
+      decodeCommand(byte);
+   } else {
+      decodeData(byte);
+   }
+}
+
+static SimCounters subtractCounters(SimCounters end, SimCounters start)
+{
+   SimCounters diff;
+   diff.commandBytes = end.commandBytes - start.commandBytes;
+   diff.dataBytes = end.dataBytes - start.dataBytes;
+   diff.vramBytes = end.vramBytes - start.vramBytes;
+   diff.csrwCommands = end.csrwCommands - start.csrwCommands;
+   diff.busClocks = end.busClocks - start.busClocks;
+   diff.timer0Interrupts = end.timer0Interrupts - start.timer0Interrupts;
+   diff.timer0Cycles = end.timer0Cycles - start.timer0Cycles;
+   diff.timer0MaxCycles = end.timer0MaxCycles;   // reset by simBeginCall
+   diff.cpuCycles = end.cpuCycles - start.cpuCycles;
+   return diff;
+}
+
+void simBeginCall(const char *name)
+{
+   strncpy(callName, name, SIM_CALL_NAME_SIZE - 1);
+   callName[SIM_CALL_NAME_SIZE - 1] = '\0';
+   totals.timer0MaxCycles = 0;
+   callStart = totals;
+}
+
+// returns the counters accumulated since simBeginCall and prints them as one table row
+SimCounters simEndCall(void)
+{
+   SimCounters diff = subtractCounters(totals, callStart);
+   printf("%-28s cmd %8lu  data %8lu  vram %8lu  csrw %7lu  clocks %9lu  cycles %11llu\n",
+          callName, diff.commandBytes, diff.dataBytes, diff.vramBytes, diff.csrwCommands,
+          diff.busClocks, diff.cpuCycles);
+   return diff;
+}
+
+SimCounters simGetTotals(void)
+{
+   return totals;
+}
+
+static const char *getCommandName(int command)
+{
+   switch (command) {
+      case SIM_C_SYS_SET:
+         return "C_SYS_SET";
+      case SIM_C_SCROLL:
+         return "C_SCROLL";
+      case SIM_C_CSRW:
+         return "C_CSRW";
+      case SIM_C_MEMWRITE:
+         return "C_MEMWRITE";
+      case SIM_C_OVERLAY:
+         return "C_OVERLAY";
+      case SIM_C_HDOT_SCR:
+         return "C_HDOT_SCR";
+      case SIM_C_DISP_ON:
+         return "C_DISP_ON";
+      case SIM_C_DISP_OFF:
+         return "C_DISP_OFF";
+      case SIM_C_CSRFORM:
+         return "C_CSRFORM";
+      case SIM_C_CSRDIR_RIGHT:
+         return "C_CSRDIR_RIGHT";
+      case SIM_C_CSRDIR_LEFT:
+         return "C_CSRDIR_LEFT";
+      case SIM_C_CSRDIR_UP:
+         return "C_CSRDIR_UP";
+      case SIM_C_CSRDIR_DOWN:
+         return "C_CSRDIR_DOWN";
+      case SIM_C_GRAYSCALE:
+         return "C_GRAYSCALE";
+   }
+   return "(unknown)";
+}
+
+void simPrintCommandTable(void)
+{
+   int command;
+   printf("%-16s %12s %12s\n", "command", "issued", "data bytes");
+   for (command = 0; command < 256; command++) {
+      if (commandStats[command].invocations > 0) {
+         printf("%-16s %12lu %12lu\n", getCommandName(command),
+                commandStats[command].invocations, commandStats[command].dataBytes);
+      }
+   }
+}
+
+const SimDisplayState *simGetState(void)
+{
+   return &state;
+}
+
+const unsigned char *simGetVram(void)
+{
+   return vram;
+}
+
+// block 1-4 start addresses as programmed by C_SCROLL (SAD1, SAD2, SAD3, SAD4)
+unsigned int simGetScreenBlockAddress(int block)
+{
+   switch (block) {
+      case 1:
+         return (state.scroll[0] | (state.scroll[1] << 8));
+      case 2:
+         return (state.scroll[3] | (state.scroll[4] << 8));
+      case 3:
+         return (state.scroll[6] | (state.scroll[7] << 8));
+      case 4:
+         return (state.scroll[8] | (state.scroll[9] << 8));
+   }
+   return 0;
+}
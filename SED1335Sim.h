@@ -0,0 +1,58 @@
+#ifndef SED1335_SIM_H
+#define SED1335_SIM_H
+
+// [SED1335 Display Controller Model]
+//    Host-side stand-in for the display and the ATmega's timers. The firmware's port writes are
+//    decoded into commands, parameters and VRAM writes, and every byte is accounted for so the
+//    display pipeline can be measured without a board.
+
+#define SIM_VRAM_SIZE 65536          // the controller addresses a full 64 KB of display memory
+#define SIM_MAX_PARAMS 16            // more parameters than any command accepts
+#define SIM_CALL_NAME_SIZE 48        // size of the label stored with each measured call
+
+// running totals, one set for the whole run and one for the call currently being measured
+typedef struct {
+   unsigned long commandBytes;      // bytes sent with A0 high
+   unsigned long dataBytes;         // bytes sent with A0 low (parameters and VRAM data)
+   unsigned long vramBytes;         // data bytes that landed in VRAM through C_MEMWRITE
+   unsigned long csrwCommands;      // number of C_CSRW commands (cursor addressing overhead)
+   unsigned long busClocks;         // CLOCK_PIN pulses that carried a byte
+   unsigned long timer0Interrupts;  // TIMER0_COMPA_vect invocations
+   unsigned long long timer0Cycles; // CPU cycles spent inside TIMER0_COMPA_vect (from HAL_CYCLES)
+   unsigned long timer0MaxCycles;   // longest single TIMER0_COMPA_vect invocation
+   unsigned long long cpuCycles;    // simulated CPU cycles at F_CPU
+} SimCounters;
+
+// decoded controller state, exposed for inspection by the host harness
+typedef struct {
+   unsigned char sysSet[8];         // last C_SYS_SET parameters
+   unsigned char scroll[10];        // last C_SCROLL parameters
+   unsigned char overlay;           // last C_OVERLAY parameter
+   unsigned char hdotScroll;        // last C_HDOT_SCR parameter
+   unsigned char displayOn;         // '1' after C_DISP_ON, '0' after C_DISP_OFF
+   unsigned char displayAttributes; // parameter of the last C_DISP_ON/C_DISP_OFF
+   unsigned int cursor;             // current cursor (VRAM write) address
+   int cursorStep;                  // address increment applied after each VRAM write
+} SimDisplayState;
+
+// simulator lifetime and time
+void simReset(void);
+void simDelayUs(double us);
+void simSetInterrupts(char enabled);
+int simKeepRunning(void);
+void simBusStrobe(void);
+void simChargeCycles(unsigned int cycles);
+unsigned long simGetCpuHz(void);
+
+// measurement
+void simBeginCall(const char *name);
+SimCounters simEndCall(void);
+SimCounters simGetTotals(void);
+void simPrintCommandTable(void);
+
+// inspection
+const SimDisplayState *simGetState(void);
+const unsigned char *simGetVram(void);
+unsigned int simGetScreenBlockAddress(int block);
+
+#endif
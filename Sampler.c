@@ -0,0 +1,224 @@
+#include <math.h>
+#include "DisplayHAL.h"
+#include "Framebuffer.h"
+#include "PlotWindow.h"
+#include "Expression.h"
+#include "Sampler.h"
+
+// rows kept beyond the window's edges: the refined margin and a screen more, so that the
+// segment towards a row clamped here still leaves the view nearly vertically
+#define SAMPLER_FAR_ROWS (FRAME_HEIGHT + SAMPLER_MARGIN_ROWS)
+
+// window of the traces being sampled (samplerSetWindow)
+static double samplerXMin;
+static double samplerXStep;
+static double samplerYTop;
+static double samplerRowScale;
+static int samplerFirstRow;                // window row stored as row 0
+// trace being sampled, set by every entry point
+static const CompiledExpression *samplerExpression;
+static int *samplerRows;                   // samplerRows[0] and bit 0 of samplerBreaks are column samplerOrigin
+static unsigned char *samplerBreaks;
+static int samplerOrigin;
+static unsigned long samplerEvaluations;   // since start-up (for measurement)
+
+// screen row of the equation at x, as a real number (NaN where it is undefined)
+static double pixelAt(double x)
+{
+   double y = evaluateExpression(samplerExpression, x);
+   samplerEvaluations++;
+   HAL_CYCLES(CYCLES_FLOAT_ADD + CYCLES_FLOAT_MUL);
+   return ((samplerYTop - y) * samplerRowScale);
+}
+
+static double columnX(int col)
+{
+   HAL_CYCLES(CYCLES_INT_TO_FLOAT + CYCLES_FLOAT_MUL + CYCLES_FLOAT_ADD);
+   return (samplerXMin + (col * samplerXStep));
+}
+
+// the row stored for a sample: clamped in window rows, so a trace sampled for any view holds the
+// same rows, moved
+static int rowEntry(double pixel)
+{
+   HAL_CYCLES((3 * CYCLES_FLOAT_CMP) + CYCLES_FLOAT_TO_INT + 4);   // floor, then a 16-bit subtract
+   if (pixel != pixel) {
+      return FRAME_EXACT_NO_ROW;
+   } else if (pixel < -SAMPLER_FAR_ROWS) {
+      return (-SAMPLER_FAR_ROWS - samplerFirstRow);
+   } else if (pixel >= (FRAME_HEIGHT + SAMPLER_FAR_ROWS)) {
+      return ((FRAME_HEIGHT + SAMPLER_FAR_ROWS - 1) - samplerFirstRow);
+   }
+   return (((int) floor(pixel)) - samplerFirstRow);
+}
+
+static void storeRow(int col, double pixel)
+{
+   samplerRows[col - samplerOrigin] = rowEntry(pixel);
+}
+
+// rows beyond the margin all look alike: a curve that stays that far off needs no refinement
+static double clampPixel(double pixel)
+{
+   if (pixel < (-1 - SAMPLER_MARGIN_ROWS)) {
+      return (-1 - SAMPLER_MARGIN_ROWS);
+   } else if (pixel > (FRAME_HEIGHT + SAMPLER_MARGIN_ROWS)) {
+      return (FRAME_HEIGHT + SAMPLER_MARGIN_ROWS);
+   }
+   return pixel;
+}
+
+// '1' if the jump from pa (at xa) to pb (at xb) survives bisection: the half holding the larger
+// part of the jump (or, when the midpoint overshoots both ends, the half beyond the overshoot)
+// is followed until the jump is small, which a continuous curve always reaches
+static char jumpPersists(double xa, double pa, double xb, double pb, int probes)
+{
+   if (probes == 0) {
+      return '1';
+   }
+   double xm = ((xa + xb) / 2);
+   double pm = pixelAt(xm);
+   if (pm != pm) {
+      return '1';
+   }
+   double low = ((pa < pb) ? pa : pb);
+   double high = ((pa < pb) ? pb : pa);
+   char leftHalf;
+   if ((pm < low) || (pm > high)) {
+      // overshoot: it is the far side of the overshoot that still has to be crossed
+      leftHalf = ((fabs(pm - pa) < fabs(pm - pb)) ? '0' : '1');
+   } else {
+      leftHalf = ((fabs(pm - pa) > fabs(pb - pm)) ? '1' : '0');
+   }
+   if (leftHalf == '1') {
+      if (fabs(pm - pa) <= FRAME_JUMP_ROWS) {
+         return '0';
+      }
+      return jumpPersists(xa, pa, xm, pm, probes - 1);
+   }
+   if (fabs(pb - pm) <= FRAME_JUMP_ROWS) {
+      return '0';
+   }
+   return jumpPersists(xm, pm, xb, pb, probes - 1);
+}
+
+static void setBreak(int col)
+{
+   samplerBreaks[(col - samplerOrigin) >> 3] |= (1 << ((col - samplerOrigin) & 0b00000111));
+}
+
+// columns ca and cb are evaluated (pa, pb) and stored; fills everything in between
+static void sampleSpan(int ca, double pa, int cb, double pb)
+{
+   if ((cb - ca) <= 1) {
+      if ((pa == pa) && (pb == pb) && (fabs(pb - pa) > FRAME_JUMP_ROWS)) {
+         if (jumpPersists(columnX(ca), pa, columnX(cb), pb, SAMPLER_POLE_PROBES) == '1') {
+            setBreak(ca);
+         }
+      }
+      return;
+   }
+   int cm = ((ca + cb) / 2);
+   double pm = pixelAt(columnX(cm));
+   storeRow(cm, pm);
+   char smooth = '0';
+   if ((pa == pa) && (pb == pb) && (pm == pm)) {
+      double chord = (clampPixel(pa) + ((clampPixel(pb) - clampPixel(pa)) * (cm - ca) / (cb - ca)));
+      HAL_CYCLES((3 * CYCLES_FLOAT_ADD) + CYCLES_FLOAT_MUL + CYCLES_FLOAT_DIV + (4 * CYCLES_FLOAT_CMP));
+      if (fabs(clampPixel(pm) - chord) <= SAMPLER_TOLERANCE_ROWS) {
+         smooth = '1';
+      }
+   }
+   if (smooth == '0') {
+      sampleSpan(ca, pa, cm, pm);
+      sampleSpan(cm, pm, cb, pb);
+      return;
+   }
+   // straight enough: interpolate both halves
+   int col;
+   double step = ((pm - pa) / (cm - ca));
+   double pixel = pa;
+   for (col = (ca + 1); col < cm; col++) {
+      pixel += step;
+      storeRow(col, pixel);
+      HAL_CYCLES(CYCLES_FLOAT_ADD);
+   }
+   step = ((pb - pm) / (cb - cm));
+   pixel = pm;
+   for (col = (cm + 1); col < cb; col++) {
+      pixel += step;
+      storeRow(col, pixel);
+      HAL_CYCLES(CYCLES_FLOAT_ADD);
+   }
+}
+
+// column c is at xMin + c * xStep; rows are stored counted from row firstRow of the window
+void samplerSetWindow(const PlotWindow *window, double xMin, double xStep, int firstRow)
+{
+   samplerXMin = xMin;
+   samplerXStep = xStep;
+   samplerYTop = (((double) window->yTop) / FIXED_ONE);
+   samplerRowScale = (((double) window->rowScale) / FIXED_ONE);
+   samplerFirstRow = firstRow;
+}
+
+unsigned long samplerGetEvaluations()
+{
+   return samplerEvaluations;
+}
+
+static void useTrace(const CompiledExpression *expression, int *rows, unsigned char *breaks, int origin)
+{
+   samplerExpression = expression;
+   samplerRows = rows;
+   samplerBreaks = breaks;
+   samplerOrigin = origin;
+}
+
+// evaluates column col (at x) as the first sample of a sweep; returns its unrounded row.
+// rows[0] and bit 0 of breaks are column origin, so a sweep can keep just the columns it draws.
+double sampleTraceStart(const CompiledExpression *expression, int *rows, unsigned char *breaks, int origin, int col,
+                        double x)
+{
+   useTrace(expression, rows, breaks, origin);
+   double pixel = pixelAt(x);
+   storeRow(col, pixel);
+   return pixel;
+}
+
+// extends a trace sampled up to column col (unrounded row pixel) to nextCol, which is at x;
+// fills the columns in between and their break bits and returns the unrounded row at nextCol
+double sampleTraceTo(const CompiledExpression *expression, int *rows, unsigned char *breaks, int origin, int col,
+                     double pixel, int nextCol, double x)
+{
+   int clear;
+   useTrace(expression, rows, breaks, origin);
+   for (clear = (col - origin); clear < (nextCol - origin); clear++) {
+      breaks[clear >> 3] &= ~(1 << (clear & 0b00000111));
+   }
+   double nextPixel = pixelAt(x);
+   storeRow(nextCol, nextPixel);
+   sampleSpan(col, pixel, nextCol, nextPixel);
+   return nextPixel;
+}
+
+// fills columns firstCol..lastCol of the trace (rows[0] and bit 0 of breaks are column origin)
+// and the break bits of the pairs inside that range; column c is at xMin + c * xStep, rows are
+// window rows. Returns the number of evaluations it took.
+unsigned int sampleTrace(const CompiledExpression *expression, const PlotWindow *window, double xMin,
+                         double xStep, int *rows, unsigned char *breaks, int origin, int firstCol, int lastCol)
+{
+   unsigned long before = samplerEvaluations;
+   samplerSetWindow(window, xMin, xStep, 0);
+   double pixel = sampleTraceStart(expression, rows, breaks, origin, firstCol, columnX(firstCol));
+   int col = firstCol;
+   while (col < lastCol) {
+      int next = (col + SAMPLER_INITIAL_STEP);
+      if (next > lastCol) {
+         next = lastCol;
+      }
+      pixel = sampleTraceTo(expression, rows, breaks, origin, col, pixel, next, columnX(next));
+      col = next;
+   }
+   return (unsigned int) (samplerEvaluations - before);
+}
@@ -0,0 +1,43 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+// [Adaptive Sampling]
+//    Fills a trace (one row per screen column) without evaluating every column. The equation is
+//    evaluated every SAMPLER_INITIAL_STEP columns; each span is then checked at its middle column
+//    and, if the curve misses the straight line between the span's ends by more than
+//    SAMPLER_TOLERANCE_ROWS, split in two and checked again, down to single columns. Columns of a
+//    span that passes are filled by interpolating in pixel space.
+//
+//    Where neighbouring evaluated columns are more than FRAME_JUMP_ROWS apart, the interval between
+//    them is bisected below column resolution (at most SAMPLER_POLE_PROBES times): a steep but
+//    continuous curve closes the gap, a pole or jump does not, and the pair gets its bit set in
+//    breaks so the renderer leaves it unconnected.
+//
+//    Traces are exact (see Framebuffer.h): a sample's row is stored as it is, counted from the
+//    window row given to samplerSetWindow(), so the same samples can be drawn into a view moved
+//    down that many rows (see [Frame] in Graph.c). Rows are followed SAMPLER_MARGIN_ROWS past the
+//    window's top and bottom edges, where such a view may still show them; further off, where
+//    nothing is shown, the curve is not refined and rows are kept at most a screen and the margin
+//    beyond the edge.
+//
+//    sampleTrace() samples one trace over a range of columns. A column sweep over several traces
+//    (drawGraph) instead sets the window once with samplerSetWindow() and advances every trace
+//    with sampleTraceTo(), computing the x of each step once for all of them. All three take the
+//    column of rows[0] (origin), so a sweep only needs the few columns it is drawing.
+//    Include Framebuffer.h, PlotWindow.h and Expression.h before this header.
+
+#define SAMPLER_INITIAL_STEP 8        // columns between the first evaluations
+#define SAMPLER_TOLERANCE_ROWS 1.0    // chord error (in rows) accepted before a span is split
+#define SAMPLER_POLE_PROBES 6         // sub-column bisections spent on one jump
+#define SAMPLER_MARGIN_ROWS 64        // rows past the window's edges the curve is still refined
+
+void samplerSetWindow(const PlotWindow *window, double xMin, double xStep, int firstRow);
+unsigned long samplerGetEvaluations();
+double sampleTraceStart(const CompiledExpression *expression, int *rows, unsigned char *breaks, int origin, int col,
+                        double x);
+double sampleTraceTo(const CompiledExpression *expression, int *rows, unsigned char *breaks, int origin, int col,
+                     double pixel, int nextCol, double x);
+unsigned int sampleTrace(const CompiledExpression *expression, const PlotWindow *window, double xMin,
+                         double xStep, int *rows, unsigned char *breaks, int origin, int firstCol, int lastCol);
+
+#endif
@@ -0,0 +1,106 @@
+#include "DisplayHAL.h"
+#include "DisplayBus.h"
+#include "Framebuffer.h"
+#include "Expression.h"
+#include "Graph.h"
+#include "Screens.h"
+
+#if FRAME_TEXT_PAGES < 2
+   #error "the command line needs a text page of its own and the other modes one more"
+#endif
+
+typedef struct {
+   char mode;                // text mode drawn into the page, 0 while the page is free
+   char variant;             // what the mode's screen was drawn from (see showScreen)
+   int cursor;               // text cursor position when the page was left
+   unsigned int lastShown;   // screenClock when the page was last shown (least recent is reused)
+} ScreenPage;
+
+ScreenPage screenPages[FRAME_TEXT_PAGES];
+unsigned int screenClock;
+int screenShown = 0;         // page screen block 1 points at while a text mode is shown
+int screenSelected = 0;      // page text is drawn into (the shown one, or the command line under a split graph)
+
+static unsigned int pageAddress(int page)
+{
+   return (unsigned int) (page * FRAME_TEXT_LAYER_BYTES);
+}
+
+// page holding mode, else the least recently shown one (free pages have never been shown); the
+// command line always has page 0
+static int findPage(char mode)
+{
+   int oldest = 1;
+   int page;
+   if (mode == 'c') {
+      return 0;
+   }
+   for (page = 1; page < FRAME_TEXT_PAGES; page++) {
+      if (screenPages[page].mode == mode) {
+         return page;
+      }
+      if (screenPages[page].lastShown < screenPages[oldest].lastShown) {
+         oldest = page;
+      }
+   }
+   return oldest;
+}
+
+// makes mode's text page the one drawn into without showing it; '1' if the page still holds the
+// screen drawn from variant, '0' if it has to be drawn in full
+char selectScreen(char mode, char variant)
+{
+   int page = findPage(mode);
+   char current = '1';
+   if ((screenPages[page].mode != mode) || (screenPages[page].variant != variant)) {
+      screenPages[page].mode = mode;
+      screenPages[page].variant = variant;
+      screenPages[page].cursor = 0;
+      current = '0';
+   }
+   screenClock++;
+   screenPages[page].lastShown = screenClock;
+   screenSelected = page;
+   return current;
+}
+
+// selectScreen() and points screen block 1 at the page
+char showScreen(char mode, char variant)
+{
+   char current = selectScreen(mode, variant);
+   busProfileBegin(BUS_OP_SCREEN_SWITCH);
+   if ((graphHide(pageAddress(screenSelected)) == '0') && (screenSelected != screenShown)) {
+      frameSetScroll(pageAddress(screenSelected), frameGetScroll(2));
+   }
+   busProfileEnd();
+   screenShown = screenSelected;
+   return current;
+}
+
+// the text mode's screen changed while it was not shown (e.g. an equation listed on it was
+// edited): its page is drawn in full the next time and is the first to be reused
+void screenInvalidate(char mode)
+{
+   int page;
+   for (page = 0; page < FRAME_TEXT_PAGES; page++) {
+      if (screenPages[page].mode == mode) {
+         screenPages[page].mode = 0;
+         screenPages[page].lastShown = 0;
+      }
+   }
+}
+
+unsigned int screenGetAddress()
+{
+   return pageAddress(screenSelected);
+}
+
+void screenSetCursor(int position)
+{
+   screenPages[screenSelected].cursor = position;
+}
+
+int screenGetCursor()
+{
+   return screenPages[screenSelected].cursor;
+}
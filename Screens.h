@@ -0,0 +1,33 @@
+#ifndef SCREENS_H
+#define SCREENS_H
+
+// [Text Screens]
+//    Each text mode ('c' command line, 'e' equation editor, 'q' equations menu, 'm' menu, 'f'
+//    special functions, 'x' diagnostics) draws into a text page that stays in display memory
+//    while other modes are shown, so everything typed into it goes there incrementally and coming
+//    back to it is a C_SCROLL of screen block 1 instead of a repaint, unless the page was handed
+//    over to another mode meanwhile. There are
+//    FRAME_TEXT_PAGES pages from address 0 up, below the graph layers (see [Layers] in Graph.c).
+//    Six pages would take 7200 bytes and the graph's three 9600-byte layers leave 3328 of the
+//    board's 32 KB, so there are two: the command line keeps page 0, as every mode goes back to
+//    it and it is also shown under a split graph, and 'e', 'q', 'm', 'f' and 'x' share the other
+//    page, the least recently shown handed over. Going between the command line (or the graph)
+//    and one of them is a C_SCROLL; going from one of them to another repaints it, at least the
+//    1200-byte page clear (see the host harness).
+//
+//    showScreen() returns '1' if the mode's page still holds the screen drawn for that variant
+//    (the argument the screen was drawn from, e.g. prevMode for the menu), '0' if the caller has
+//    to draw it in full. selectScreen() does the same without showing the page, for the command
+//    line under a split graph (see graphShowText). Text positions (the cursor, drawCharacter) are
+//    relative to screenGetAddress(), the page selected last. screenSetCursor() keeps the text
+//    cursor of that page, so it can be put back when the page is selected again.
+//    Include Expression.h before this header.
+
+char selectScreen(char mode, char variant);
+char showScreen(char mode, char variant);
+void screenInvalidate(char mode);
+unsigned int screenGetAddress();
+void screenSetCursor(int position);
+int screenGetCursor();
+
+#endif
@@ -0,0 +1,121 @@
+# [SRAM Estimate]
+#    Part of `make sram-report` when there is no avr-gcc: reads `readelf --debug-dump=info` of one
+#    host object built with -g and prints the bytes its static variables take on the ATmega328P.
+#    Every variable with a fixed address (DW_OP_addr) counts, sized from its debug type with the
+#    avr-gcc sizes: char 1, short/int/enum/pointer 2, long/float/double 4, long long 8, structs
+#    the sum of their members (the AVR does not pad) and unions their largest member.
+#    > progmem: names of the object's PROGMEM variables (from nm), which stay in flash
+#    > strings: bytes of the object's string literals (they are copied to SRAM at start-up)
+#    > module: name printed in front of the total; verbose=1 lists the variables too
+
+BEGIN {
+   count = split(progmem, names, " ");
+   for (i = 1; i <= count; i++) {
+      inFlash[names[i]] = 1;
+   }
+}
+
+# " <1><2e>: Abbrev Number: 1 (DW_TAG_base_type)"; depth 1 is the compile unit's children
+/^ *<[0-9]+><[0-9a-f]+>: Abbrev Number/ {
+   split($0, fields, /[<>]/);
+   depth = fields[2];
+   die = fields[4];
+   parent[depth] = die;
+   if ($NF ~ /^\(DW_TAG_/) {
+      tag[die] = substr($NF, 2, length($NF) - 2);
+      if (depth > 0) {
+         children[parent[depth - 1]] = children[parent[depth - 1]] " " die;
+      }
+      order[++dies] = die;
+   }
+   next
+}
+
+# "    <2f>   DW_AT_byte_size   : 8"
+/^ *<[0-9a-f]+> +DW_AT_/ {
+   attribute = $2;
+   sub(/:$/, "", attribute);
+   value = $0;
+   sub(/^[^:]*: ?/, "", value);
+   if (value ~ /^\(indirect/) {
+      sub(/^[^)]*\): /, "", value);   # "(indirect string, offset: 0x10f): long unsigned int"
+   }
+   if ((attribute == "DW_AT_type") || (attribute == "DW_AT_specification")) {
+      gsub(/[<>]|0x/, "", value);
+      value = value "";
+   }
+   attributes[die, attribute] = value;
+}
+
+function typeSize(die,    name, size, kid, kids, n, i) {
+   if ((tag[die] == "DW_TAG_typedef") || (tag[die] == "DW_TAG_const_type") || (tag[die] == "DW_TAG_volatile_type")) {
+      return typeSize(attributes[die, "DW_AT_type"]);
+   }
+   if ((tag[die] == "DW_TAG_pointer_type") || (tag[die] == "DW_TAG_enumeration_type")) {
+      return 2;
+   }
+   if (tag[die] == "DW_TAG_base_type") {
+      name = attributes[die, "DW_AT_name"];
+      if ((name ~ /float|double/) || ((name ~ /long/) && (name !~ /long long/))) {
+         return 4;
+      }
+      if (name ~ /long long/) {
+         return 8;
+      }
+      if (name ~ /int/) {
+         return 2;
+      }
+      return 1;   # char, _Bool
+   }
+   size = 0;
+   n = split(children[die], kids, " ");
+   if (tag[die] == "DW_TAG_array_type") {
+      size = typeSize(attributes[die, "DW_AT_type"]);
+      for (i = 1; i <= n; i++) {
+         if ((kids[i], "DW_AT_upper_bound") in attributes) {
+            size *= (attributes[kids[i], "DW_AT_upper_bound"] + 1);
+         } else if ((kids[i], "DW_AT_count") in attributes) {
+            size *= attributes[kids[i], "DW_AT_count"];
+         }
+      }
+      return size;
+   }
+   for (i = 1; i <= n; i++) {
+      if (tag[kids[i]] == "DW_TAG_member") {
+         kid = typeSize(attributes[kids[i], "DW_AT_type"]);
+         if (tag[die] == "DW_TAG_union_type") {
+            size = ((kid > size) ? kid : size);
+         } else {
+            size += kid;
+         }
+      }
+   }
+   return size;
+}
+
+END {
+   total = strings + 0;
+   for (i = 1; i <= dies; i++) {
+      die = order[i];
+      if ((tag[die] != "DW_TAG_variable") || (attributes[die, "DW_AT_location"] !~ /DW_OP_addr/)) {
+         continue;
+      }
+      declaration = die;
+      if ((die, "DW_AT_specification") in attributes) {
+         declaration = attributes[die, "DW_AT_specification"];
+      }
+      name = attributes[declaration, "DW_AT_name"];
+      if (name in inFlash) {
+         continue;
+      }
+      size = typeSize(attributes[declaration, "DW_AT_type"]);
+      total += size;
+      if (verbose == 1) {
+         printf("      %-26s %6d\n", name, size);
+      }
+   }
+   if ((verbose == 1) && (strings > 0)) {
+      printf("      %-26s %6d\n", "(string literals)", strings);
+   }
+   printf("   %-20s %6d\n", module, total);
+}
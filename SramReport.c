@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stddef.h>
+#define HOST_PROGRAM
+#include "DisplayHAL.h"
+#include "Expression.h"
+#include "Graph.h"
+#include "TextEditor.h"
+#include "Arena.h"
+
+// [SRAM Report]
+//    Second half of `make sram-report`: the arena's regions from its layout table. The sizes are
+//    those of the compiler that built this program (the host build has 8-byte doubles and pointers
+//    where avr-gcc has 4 and 2). The table lives here, in the only program that reads it, so it
+//    takes no space in the firmware.
+
+typedef struct {
+   const char *name;
+   unsigned int offset;   // bytes from the start of the arena
+   unsigned int size;
+} ArenaRegion;
+
+#define ARENA_REGIONS 7
+#define ARENA_REGION(member) { #member, offsetof(Arena, member), sizeof(((Arena *) 0)->member) }
+
+static const ArenaRegion arenaLayout[ARENA_REGIONS] = {
+   ARENA_REGION(equations),
+   ARENA_REGION(compiledEquations),
+   ARENA_REGION(commandText),
+   ARENA_REGION(commandEditor),
+   ARENA_REGION(functionText),
+   ARENA_REGION(functionEditor),
+   ARENA_REGION(windowBounds)
+};
+
+// linked against the model for the editor's cycle annotations only; no keypad polling
+void TIMER1_COMPA_vect(void)
+{
+}
+
+int main(void)
+{
+   int i;
+   printf("arena layout (%u bytes)\n", (unsigned int) sizeof(Arena));
+   for (i = 0; i < ARENA_REGIONS; i++) {
+      printf("   %-20s offset %5u  size %5u\n", arenaLayout[i].name, arenaLayout[i].offset, arenaLayout[i].size);
+   }
+   return 0;
+}
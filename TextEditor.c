@@ -0,0 +1,154 @@
+#include "DisplayHAL.h"
+#include "TextEditor.h"
+
+// storage of size bytes (at most TEXT_EDITOR_MAX_SIZE); the editor starts empty with the cursor at 0
+void editorInit(TextEditor *editor, char *storage, unsigned int size)
+{
+   editor->text = storage;
+   editor->capacity = (unsigned char) (size - 1);
+   editor->gapStart = 0;
+   editor->gapEnd = editor->capacity;
+   editor->cursor = 0;
+   editor->changedFirst = 1;   // nothing changed
+   editor->changedLast = 0;
+}
+
+unsigned int editorGetLength(const TextEditor *editor)
+{
+   return (editor->gapStart + (editor->capacity - editor->gapEnd));
+}
+
+unsigned int editorGetCursor(const TextEditor *editor)
+{
+   return editor->cursor;
+}
+
+// first and last are positions of the text (0..capacity - 1)
+static void markChanged(TextEditor *editor, int first, int last)
+{
+   if (editor->changedFirst > editor->changedLast) {
+      editor->changedFirst = (unsigned char) first;
+      editor->changedLast = (unsigned char) last;
+      return;
+   }
+   if (first < editor->changedFirst) {
+      editor->changedFirst = (unsigned char) first;
+   }
+   if (last > editor->changedLast) {
+      editor->changedLast = (unsigned char) last;
+   }
+}
+
+// brings the gap to the cursor, shifting the characters in between across it
+static void moveGap(TextEditor *editor)
+{
+   while (editor->gapStart > editor->cursor) {
+      editor->gapStart--;
+      editor->gapEnd--;
+      editor->text[editor->gapEnd] = editor->text[editor->gapStart];
+      HAL_CYCLES(8);   // ld -X, st -Y, compare
+   }
+   while (editor->gapStart < editor->cursor) {
+      editor->text[editor->gapStart] = editor->text[editor->gapEnd];
+      editor->gapStart++;
+      editor->gapEnd++;
+      HAL_CYCLES(8);   // ld X+, st Y+, compare
+   }
+}
+
+// empties the text; every position it covered has to be redrawn
+void editorClear(TextEditor *editor)
+{
+   int length = (int) editorGetLength(editor);
+   if (length > 0) {
+      markChanged(editor, 0, length - 1);
+   }
+   editor->gapStart = 0;
+   editor->gapEnd = editor->capacity;
+   editor->cursor = 0;
+}
+
+// inserts character at the cursor and moves past it; '0' if the text is full
+char editorInsert(TextEditor *editor, char character)
+{
+   HAL_CYCLES(24);   // call/return, full test, store, index and span updates
+   if (editor->gapStart == editor->gapEnd) {
+      return '0';
+   }
+   moveGap(editor);
+   editor->text[editor->gapStart] = character;
+   editor->gapStart++;
+   editor->cursor++;
+   // the characters after the cursor each moved one position to the right
+   markChanged(editor, (int) editor->cursor - 1, (int) editorGetLength(editor) - 1);
+   return '1';
+}
+
+// deletes the character under the cursor; '0' if the cursor is at the end of the text
+char editorDelete(TextEditor *editor)
+{
+   HAL_CYCLES(24);   // call/return, end test, index and span updates
+   unsigned int length = editorGetLength(editor);
+   if (editor->cursor >= length) {
+      return '0';
+   }
+   moveGap(editor);
+   editor->gapEnd++;
+   // the characters after the cursor each moved one position to the left, the last one is blank
+   markChanged(editor, (int) editor->cursor, (int) length - 1);
+   return '1';
+}
+
+// moves the cursor by offset characters; '0' (and no move) if that leaves the text
+char editorMoveCursor(TextEditor *editor, int offset)
+{
+   long position = ((long) editor->cursor + offset);
+   if ((position < 0) || (position > (long) editorGetLength(editor))) {
+      return '0';
+   }
+   editor->cursor = (unsigned char) position;
+   return '1';
+}
+
+void editorSetCursor(TextEditor *editor, unsigned int position)
+{
+   unsigned int length = editorGetLength(editor);
+   editor->cursor = (unsigned char) ((position > length) ? length : position);
+}
+
+// character shown at position, ' ' past the end of the text
+char editorCharAt(const TextEditor *editor, unsigned int position)
+{
+   if (position < editor->gapStart) {
+      return editor->text[position];
+   }
+   position += (editor->gapEnd - editor->gapStart);
+   if (position < editor->capacity) {
+      return editor->text[position];
+   }
+   return ' ';
+}
+
+// the whole text as one terminated string (the gap is moved behind it)
+const char *editorText(TextEditor *editor)
+{
+   unsigned char cursor = editor->cursor;
+   editor->cursor = (unsigned char) editorGetLength(editor);
+   moveGap(editor);
+   editor->cursor = cursor;
+   editor->text[editor->gapStart] = '\0';
+   return editor->text;
+}
+
+// '1' with the positions changed since the last call in first..last, '0' if nothing changed
+char editorTakeChange(TextEditor *editor, int *first, int *last)
+{
+   if (editor->changedFirst > editor->changedLast) {
+      return '0';
+   }
+   *first = editor->changedFirst;
+   *last = editor->changedLast;
+   editor->changedFirst = 1;   // nothing changed
+   editor->changedLast = 0;
+   return '1';
+}
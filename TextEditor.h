@@ -0,0 +1,41 @@
+#ifndef TEXT_EDITOR_H
+#define TEXT_EDITOR_H
+
+// [Text Editor]
+//    Gap buffer behind the command line, the equations and the function selection. The text
+//    before the gap sits at the start of the caller's storage and the text after it at the end,
+//    so inserting or deleting at the gap is O(1). The gap follows the cursor lazily: moving the
+//    cursor is O(1), and the first edit after a move shifts only the characters between the old and
+//    new position. Typing at one spot therefore never shifts anything.
+//
+//    Each edit records which character positions now show something else, since the positions
+//    after an insertion or a deletion move. editorTakeChange() hands over the span changed since
+//    it was last called, so a screen redraws only those characters (positions past the end of the
+//    text read as ' ', which erases what a deletion left behind). editorText() closes the gap and
+//    terminates the text for the parser and for full-screen draws.
+
+#define TEXT_EDITOR_MAX_SIZE 256   // storage bytes an editor can index (positions are single bytes)
+
+typedef struct {
+   char *text;                // caller's storage: text before the gap, the gap, text after it
+   unsigned char capacity;    // characters the storage holds (one byte more is kept for the terminator)
+   unsigned char gapStart;    // length of the text before the gap
+   unsigned char gapEnd;      // index of the first character after the gap
+   unsigned char cursor;      // position edits happen at (0..length)
+   unsigned char changedFirst;   // span of positions changed since editorTakeChange(), first > last if none
+   unsigned char changedLast;
+} TextEditor;
+
+void editorInit(TextEditor *editor, char *storage, unsigned int size);
+void editorClear(TextEditor *editor);
+char editorInsert(TextEditor *editor, char character);
+char editorDelete(TextEditor *editor);
+char editorMoveCursor(TextEditor *editor, int offset);
+void editorSetCursor(TextEditor *editor, unsigned int position);
+unsigned int editorGetCursor(const TextEditor *editor);
+unsigned int editorGetLength(const TextEditor *editor);
+char editorCharAt(const TextEditor *editor, unsigned int position);
+const char *editorText(TextEditor *editor);
+char editorTakeChange(TextEditor *editor, int *first, int *last);
+
+#endif